@@ -0,0 +1,267 @@
+/**
+ * @file async_log.c
+ * @date 17 Oct 2026
+ * @brief In-process asynchronous logger
+ *
+ *        The ring is a bounded array of slots with a sequence number
+ *        each.  A producer claims a slot by advancing tail with a CAS,
+ *        fills it and publishes it by storing the next sequence number;
+ *        the writer thread consumes slots in order and hands them back
+ *        with sequence + capacity.  Producers only take time(), which
+ *        the vDSO answers without entering the kernel.
+ *
+ *        The writer formats the timestamp once per second, collects
+ *        records in an output buffer and writes it when it is full or
+ *        the ring ran empty, then naps for LOG_IDLE_NS.
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#define _POSIX_C_SOURCE     200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include "async_log.h"
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define LOG_OUT_BUF     65536
+#define LOG_IDLE_NS     10000000L
+#define LOG_STAMP_LEN   32
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef struct log_slot_s {
+  size_t seq;
+  time_t when;
+  char msg[ASYNC_LOG_MSG_LEN];
+} log_slot_t;
+
+struct async_log_s {
+  log_slot_t *ring;
+  size_t mask;
+  async_log_policy_t policy;
+
+  /* producers and the writer on different cache lines */
+  char pad0[64];
+  size_t tail;
+  char pad1[64];
+  size_t head;
+  uint64_t dropped;
+  int stop;
+
+  int fd;
+  pthread_t thread;
+  char *out;
+  size_t out_len;
+
+  /* cached "Mon Oct 17 12:00:00 2026" of stamp_sec */
+  time_t stamp_sec;
+  char stamp[LOG_STAMP_LEN];
+};
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal write the output buffer, retry partial writes
+ *
+ */
+static void log_write_out(async_log_t *log)
+{
+  size_t off = 0;
+  ssize_t n;
+
+  while (off < log->out_len) {
+    n = write(log->fd, log->out + off, log->out_len - off);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      perror("write log");
+      break;
+    }
+    off += (size_t)n;
+  }
+  log->out_len = 0;
+}
+
+/** @internal append one record with its timestamp to the output buffer
+ *
+ */
+static void log_append(async_log_t *log, const log_slot_t *slot)
+{
+  struct tm tm;
+  size_t len = strlen(slot->msg);
+
+  if (slot->when != log->stamp_sec || log->stamp[0] == '\0') {
+    localtime_r(&slot->when, &tm);
+    strftime(log->stamp, sizeof(log->stamp), "%a %b %e %H:%M:%S %Y", &tm);
+    log->stamp_sec = slot->when;
+  }
+
+  if (LOG_OUT_BUF - log->out_len < LOG_STAMP_LEN + 12 + len + 1) {
+    log_write_out(log);
+  }
+  log->out_len += (size_t)sprintf(log->out + log->out_len,
+                                  "%s           %s\n", log->stamp,
+                                  slot->msg);
+}
+
+/** @internal writer thread
+ *
+ */
+static void *log_thread(void *ptr)
+{
+  async_log_t *log = ptr;
+  struct timespec idle = { 0, LOG_IDLE_NS };
+  log_slot_t *slot;
+  int stop;
+
+  while (1) {
+    /* check stop first, records queued before it are still drained */
+    stop = __atomic_load_n(&log->stop, __ATOMIC_ACQUIRE);
+
+    slot = &log->ring[log->head & log->mask];
+    while (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) ==
+           log->head + 1) {
+      log_append(log, slot);
+      __atomic_store_n(&slot->seq, log->head + log->mask + 1,
+                       __ATOMIC_RELEASE);
+      log->head++;
+      slot = &log->ring[log->head & log->mask];
+    }
+
+    if (log->out_len > 0) {
+      log_write_out(log);
+    }
+    if (stop) {
+      break;
+    }
+    nanosleep(&idle, NULL);
+  }
+
+  return NULL;
+}
+
+async_log_t *async_log_open(const char *path, size_t capacity,
+                            async_log_policy_t policy)
+{
+  async_log_t *log;
+  size_t cap, i;
+  int err;
+
+  for (cap = 2; cap < capacity; cap *= 2) {
+  }
+
+  if ((log = calloc(1, sizeof(*log))) == NULL) {
+    return NULL;
+  }
+  log->fd = -1;
+  log->mask = cap - 1;
+  log->policy = policy;
+  log->ring = calloc(cap, sizeof(log_slot_t));
+  log->out = malloc(LOG_OUT_BUF);
+  if (log->ring == NULL || log->out == NULL) {
+    goto fail;
+  }
+  for (i = 0; i < cap; i++) {
+    log->ring[i].seq = i;
+  }
+
+  if ((log->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+    goto fail;
+  }
+  if ((err = pthread_create(&log->thread, NULL, log_thread, log)) != 0) {
+    errno = err;
+    goto fail;
+  }
+
+  return log;
+
+fail:
+  err = errno;
+  if (log->fd >= 0) {
+    close(log->fd);
+  }
+  free(log->ring);
+  free(log->out);
+  free(log);
+  errno = err;
+  return NULL;
+}
+
+void async_log_close(async_log_t *log)
+{
+  if (log == NULL) {
+    return;
+  }
+
+  __atomic_store_n(&log->stop, 1, __ATOMIC_RELEASE);
+  pthread_join(log->thread, NULL);
+
+  close(log->fd);
+  free(log->ring);
+  free(log->out);
+  free(log);
+}
+
+int async_log_printf(async_log_t *log, const char *fmt, ...)
+{
+  log_slot_t *slot;
+  size_t pos, seq;
+  va_list ap;
+
+  if (log == NULL) {
+    return -1;
+  }
+
+  pos = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+  while (1) {
+    slot = &log->ring[pos & log->mask];
+    seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq == pos) {
+      /* slot free => claim it, a failed CAS reloads pos */
+      if (__atomic_compare_exchange_n(&log->tail, &pos, pos + 1, 1,
+                                      __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        break;
+      }
+    } else if ((ptrdiff_t)(seq - pos) < 0) {
+      /* ring full */
+      if (log->policy == ASYNC_LOG_DROP) {
+        __atomic_fetch_add(&log->dropped, 1, __ATOMIC_RELAXED);
+        return -1;
+      }
+      sched_yield();
+      pos = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+    } else {
+      /* another producer took it */
+      pos = __atomic_load_n(&log->tail, __ATOMIC_RELAXED);
+    }
+  }
+
+  slot->when = time(NULL);
+  va_start(ap, fmt);
+  vsnprintf(slot->msg, sizeof(slot->msg), fmt, ap);
+  va_end(ap);
+
+  /* publish to the writer */
+  __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+uint64_t async_log_dropped(const async_log_t *log)
+{
+  return log ? __atomic_load_n(&log->dropped, __ATOMIC_RELAXED) : 0;
+}
+
+/*EOF*/
@@ -0,0 +1,57 @@
+/**
+ * @file async_log.h
+ * @date 17 Oct 2026
+ * @brief In-process asynchronous logger
+ *
+ *        Any thread formats a record into a slot of a bounded ring
+ *        (multi producer, single consumer, no locks).  One writer
+ *        thread prefixes the records with a timestamp and writes many
+ *        of them with a single write().  Logging a record costs no
+ *        syscall unless the ring is full and the policy is to block.
+ *
+ */
+
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief longest record, longer ones are truncated */
+#define ASYNC_LOG_MSG_LEN   120
+
+typedef struct async_log_s async_log_t;
+
+/** @brief what a producer does when the ring is full */
+typedef enum {
+  ASYNC_LOG_DROP = 0,   /**< discard the record and count it */
+  ASYNC_LOG_BLOCK       /**< yield until the writer made room */
+} async_log_policy_t;
+
+/** @brief create/truncate the log file and start the writer thread
+ *
+ *  @param capacity number of records the ring holds, rounded up to a
+ *                  power of two
+ *
+ *  @retrun NULL on error (errno set)
+ */
+async_log_t *async_log_open(const char *path, size_t capacity,
+                            async_log_policy_t policy);
+
+/** @brief write all queued records, stop the writer and close the file
+ */
+void async_log_close(async_log_t *log);
+
+/** @brief queue one printf style record, a newline is appended
+ *
+ *  @retrun 0 => queued, -1 => dropped (ring full)
+ */
+int async_log_printf(async_log_t *log, const char *fmt, ...)
+__attribute__((format(printf, 2, 3)));
+
+/** @brief number of records dropped because the ring was full */
+uint64_t async_log_dropped(const async_log_t *log);
+
+#endif
+
+/*EOF*/
@@ -0,0 +1,518 @@
+/**
+ * @file cluster.c
+ * @date 17 Oct 2026
+ * @brief Coordinator side of the hash server cluster mode
+ *
+ *        A search owns CLUSTER_RANGES ranges of the candidate space,
+ *        each one pending, assigned to a worker or done.  Whenever a
+ *        worker has less than depth ranges in flight it gets the
+ *        lowest pending range of the oldest search, so the ranges in
+ *        front of a match finish first.  The request id of a range is
+ *        the search sequence number (upper 24 bit) and the range index
+ *        (lower 8 bit), a reply of a search that ended meanwhile only
+ *        frees its slot on the worker.
+ *
+ *        Every CRACK_RANGE is answered exactly once (RANGE_RESULT,
+ *        BUSY or ERROR), also after a CANCEL, so the number of ranges
+ *        in flight per worker stays exact.  A reported match is
+ *        checked before it counts, a worker that reports a wrong one
+ *        is dropped and its ranges go to the others.  A range that
+ *        comes back BUSY, with an error or aborted by the worker waits
+ *        an exponential backoff and prefers another worker next time;
+ *        after CLUSTER_MAX_ATTEMPTS tries the search fails.
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#define _POSIX_C_SOURCE     200809L
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "cluster.h"
+#include "crc32.h"
+#include "hash_crack.h"
+#include "protocol.h"
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define CLUSTER_RANGE_BITS  26
+#define CLUSTER_RANGES      (1u << (32 - CLUSTER_RANGE_BITS))
+#define CLUSTER_WAIT_NS     100000000L
+#define CLUSTER_BACKOFF_NS  10000000ull
+#define CLUSTER_MAX_ATTEMPTS 5
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef enum {
+  RANGE_PENDING = 0,
+  RANGE_ASSIGNED,
+  RANGE_DONE
+} range_state_t;
+
+typedef struct cluster_worker_s {
+  struct cluster_worker_s *next;
+  void *peer;
+  int inflight;
+} cluster_worker_t;
+
+/* last is the worker of the last failed try, only compared */
+typedef struct cluster_range_s {
+  range_state_t state;
+  int cancelled;
+  cluster_worker_t *worker;
+  cluster_worker_t *last;
+  int attempts;
+  uint64_t not_before;
+} cluster_range_t;
+
+typedef struct cluster_search_s {
+  struct cluster_search_s *next;
+  uint32_t seq;
+  uint32_t crc;
+  uint64_t best;
+  int finished;
+  int failed;
+  cluster_range_t range[CLUSTER_RANGES];
+} cluster_search_t;
+
+struct cluster_s {
+  pthread_mutex_t lock;
+  pthread_cond_t changed;
+  cluster_mode_t mode;
+  int depth;
+  cluster_send_fn_t send;
+  cluster_worker_t *workers;
+  int worker_count;
+  cluster_search_t *searches;
+  uint32_t seq;
+};
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal monotonic clock in ns
+ *
+ */
+static uint64_t cluster_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/** @internal request id of range i of s
+ *
+ */
+static uint32_t range_id(const cluster_search_t *s, unsigned i)
+{
+  return (s->seq << 8) | i;
+}
+
+/** @internal does range i still matter for the result of s
+ *
+ */
+static int range_needed(const cluster_t *cl, const cluster_search_t *s,
+                        unsigned i)
+{
+  if (s->failed) {
+    return 0;
+  }
+  if (s->best == UINT64_MAX) {
+    return 1;
+  }
+
+  return cl->mode == CLUSTER_LOWEST &&
+         ((uint64_t)i << CLUSTER_RANGE_BITS) <= s->best;
+}
+
+/** @internal cancel what is no longer needed, detect the end of s
+ *
+ */
+static void search_update(cluster_t *cl, cluster_search_t *s)
+{
+  cluster_range_t *r;
+  unsigned i;
+  int open = 0;
+
+  for (i = 0; i < CLUSTER_RANGES; i++) {
+    r = &s->range[i];
+    if (range_needed(cl, s, i)) {
+      open |= r->state != RANGE_DONE;
+    } else if (r->state == RANGE_PENDING) {
+      r->state = RANGE_DONE;
+    } else if (r->state == RANGE_ASSIGNED && !r->cancelled) {
+      cl->send(r->worker->peer, PROTO_CANCEL, range_id(s, i), NULL, 0);
+      r->cancelled = 1;
+    }
+  }
+
+  if (!open && !s->finished) {
+    s->finished = 1;
+    pthread_cond_broadcast(&cl->changed);
+  }
+}
+
+/** @internal lowest pending range of the oldest search for worker w,
+ *            a range in backoff waits and one that failed on w goes
+ *            to the other workers if there are any
+ *
+ *  @retrun NULL => nothing to do
+ */
+static cluster_search_t *next_range(cluster_t *cl, cluster_worker_t *w,
+                                    uint64_t now, unsigned *index)
+{
+  cluster_search_t *s;
+  cluster_range_t *r;
+  unsigned i;
+
+  for (s = cl->searches; s != NULL; s = s->next) {
+    for (i = 0; i < CLUSTER_RANGES; i++) {
+      r = &s->range[i];
+      if (r->state == RANGE_PENDING && r->not_before <= now &&
+          (r->last != w || cl->worker_count == 1)) {
+        *index = i;
+        return s;
+      }
+    }
+  }
+
+  return NULL;
+}
+
+/** @internal end of the earliest backoff, 0 => none
+ *
+ */
+static uint64_t next_retry(cluster_t *cl)
+{
+  cluster_search_t *s;
+  cluster_range_t *r;
+  uint64_t next = 0;
+  unsigned i;
+
+  for (s = cl->searches; s != NULL; s = s->next) {
+    for (i = 0; i < CLUSTER_RANGES; i++) {
+      r = &s->range[i];
+      if (r->state == RANGE_PENDING && r->not_before != 0 &&
+          (next == 0 || r->not_before < next)) {
+        next = r->not_before;
+      }
+    }
+  }
+
+  return next;
+}
+
+/** @internal fill the free slots of all workers, one range per worker
+ *            and round
+ *
+ */
+static void cluster_schedule(cluster_t *cl)
+{
+  cluster_worker_t *w;
+  cluster_search_t *s;
+  uint8_t payload[12];
+  uint64_t now = cluster_now();
+  unsigned i;
+  uint32_t first;
+  int level;
+
+  for (level = 0; level < cl->depth; level++) {
+    for (w = cl->workers; w != NULL; w = w->next) {
+      if (w->inflight > level || (s = next_range(cl, w, now, &i)) == NULL) {
+        continue;
+      }
+      s->range[i].state = RANGE_ASSIGNED;
+      s->range[i].cancelled = 0;
+      s->range[i].worker = w;
+      w->inflight++;
+
+      first = i << CLUSTER_RANGE_BITS;
+      proto_put_u32(payload, s->crc);
+      proto_put_u32(payload + 4, first);
+      proto_put_u32(payload + 8,
+                    first + ((1u << CLUSTER_RANGE_BITS) - 1));
+      cl->send(w->peer, PROTO_CRACK_RANGE, range_id(s, i), payload,
+               sizeof(payload));
+    }
+  }
+}
+
+/** @internal worker entry of peer, lock must be held
+ *
+ */
+static cluster_worker_t *find_worker(cluster_t *cl, void *peer)
+{
+  cluster_worker_t *w;
+
+  for (w = cl->workers; w != NULL && w->peer != peer; w = w->next) {
+  }
+
+  return w;
+}
+
+/** @internal unlink worker w and hand its ranges to the others, lock
+ *            must be held
+ *
+ */
+static void worker_drop(cluster_t *cl, cluster_worker_t *w)
+{
+  cluster_worker_t **pw;
+  cluster_search_t *s;
+  cluster_range_t *r;
+  unsigned i;
+
+  for (pw = &cl->workers; *pw != w; pw = &(*pw)->next) {
+  }
+  *pw = w->next;
+  cl->worker_count--;
+
+  /* its ranges start over on the others */
+  for (s = cl->searches; s != NULL; s = s->next) {
+    for (i = 0; i < CLUSTER_RANGES; i++) {
+      r = &s->range[i];
+      if (r->state == RANGE_ASSIGNED && r->worker == w) {
+        r->state = r->cancelled ? RANGE_DONE : RANGE_PENDING;
+        r->worker = NULL;
+      }
+    }
+    search_update(cl, s);
+  }
+  free(w);
+
+  cluster_schedule(cl);
+  /* a search without workers left falls back to a local one */
+  pthread_cond_broadcast(&cl->changed);
+}
+
+/** @internal is hit a match of s inside range i
+ *
+ */
+static int hit_valid(const cluster_search_t *s, unsigned i, uint32_t hit)
+{
+  uint8_t bytes[4];
+
+  if (hit >> CLUSTER_RANGE_BITS != i) {
+    return 0;
+  }
+  crack_candidate_bytes(hit, bytes);
+
+  return crc32(bytes, sizeof(bytes)) == s->crc;
+}
+
+cluster_t *cluster_create(cluster_mode_t mode, int depth,
+                          cluster_send_fn_t send)
+{
+  pthread_condattr_t attr;
+  cluster_t *cl;
+
+  if ((cl = calloc(1, sizeof(*cl))) == NULL) {
+    return NULL;
+  }
+  cl->mode = mode;
+  cl->depth = depth > 0 ? depth : 1;
+  cl->send = send;
+  pthread_mutex_init(&cl->lock, NULL);
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cl->changed, &attr);
+  pthread_condattr_destroy(&attr);
+
+  return cl;
+}
+
+void cluster_destroy(cluster_t *cl)
+{
+  cluster_worker_t *w;
+
+  if (cl == NULL) {
+    return;
+  }
+
+  while ((w = cl->workers) != NULL) {
+    cl->workers = w->next;
+    free(w);
+  }
+  pthread_mutex_destroy(&cl->lock);
+  pthread_cond_destroy(&cl->changed);
+  free(cl);
+}
+
+void cluster_worker_add(cluster_t *cl, void *peer)
+{
+  cluster_worker_t *w;
+
+  if ((w = calloc(1, sizeof(*w))) == NULL) {
+    return;
+  }
+  w->peer = peer;
+
+  pthread_mutex_lock(&cl->lock);
+  w->next = cl->workers;
+  cl->workers = w;
+  cl->worker_count++;
+  cluster_schedule(cl);
+  pthread_mutex_unlock(&cl->lock);
+}
+
+void cluster_worker_remove(cluster_t *cl, void *peer)
+{
+  cluster_worker_t *w;
+
+  pthread_mutex_lock(&cl->lock);
+  if ((w = find_worker(cl, peer)) != NULL) {
+    worker_drop(cl, w);
+  }
+  pthread_mutex_unlock(&cl->lock);
+}
+
+int cluster_workers(cluster_t *cl)
+{
+  int count;
+
+  pthread_mutex_lock(&cl->lock);
+  count = cl->worker_count;
+  pthread_mutex_unlock(&cl->lock);
+
+  return count;
+}
+
+int cluster_reply(cluster_t *cl, void *peer, uint32_t id, uint16_t type,
+                  const uint8_t *payload, uint32_t len)
+{
+  cluster_worker_t *w;
+  cluster_search_t *s;
+  cluster_range_t *r;
+  uint32_t status = PROTO_RANGE_CANCELLED, hit = 0;
+  unsigned i = id & 0xFF;
+
+  pthread_mutex_lock(&cl->lock);
+  if ((w = find_worker(cl, peer)) == NULL) {
+    pthread_mutex_unlock(&cl->lock);
+    return 0;
+  }
+  w->inflight--;
+
+  for (s = cl->searches; s != NULL && s->seq != id >> 8; s = s->next) {
+  }
+  if (s != NULL && i < CLUSTER_RANGES) {
+    r = &s->range[i];
+    if (r->state == RANGE_ASSIGNED && r->worker == w) {
+      if (type == PROTO_RANGE_RESULT && len >= 8) {
+        status = proto_get_u32(payload);
+        hit = proto_get_u32(payload + 4);
+      }
+      r->worker = NULL;
+      if (status == PROTO_RANGE_FOUND && !hit_valid(s, i, hit)) {
+        /* a broken or lying worker, the range starts over elsewhere */
+        r->state = RANGE_PENDING;
+        worker_drop(cl, w);
+        pthread_mutex_unlock(&cl->lock);
+        return -1;
+      } else if (status == PROTO_RANGE_FOUND) {
+        r->state = RANGE_DONE;
+        if (hit < s->best) {
+          s->best = hit;
+        }
+      } else if (status == PROTO_RANGE_NONE) {
+        r->state = RANGE_DONE;
+      } else if (r->cancelled) {
+        /* search_update() drops it */
+        r->state = RANGE_PENDING;
+      } else if (++r->attempts >= CLUSTER_MAX_ATTEMPTS) {
+        r->state = RANGE_DONE;
+        s->failed = 1;
+      } else {
+        /* BUSY, error or aborted by the worker => once more, later
+           and elsewhere */
+        r->state = RANGE_PENDING;
+        r->last = w;
+        r->not_before = cluster_now() +
+                        (CLUSTER_BACKOFF_NS << (r->attempts - 1));
+      }
+      search_update(cl, s);
+    }
+  }
+
+  cluster_schedule(cl);
+  pthread_mutex_unlock(&cl->lock);
+
+  return 0;
+}
+
+int cluster_search(cluster_t *cl, uint32_t crc, uint64_t deadline,
+                   uint32_t *result, volatile sig_atomic_t *run)
+{
+  cluster_search_t *s, **ps;
+  struct timespec ts;
+  uint64_t now, wake, retry;
+  unsigned i;
+  int ret, expired = 0;
+
+  if ((s = calloc(1, sizeof(*s))) == NULL) {
+    return 1;
+  }
+  s->crc = crc;
+  s->best = UINT64_MAX;
+
+  pthread_mutex_lock(&cl->lock);
+  if (cl->worker_count == 0) {
+    pthread_mutex_unlock(&cl->lock);
+    free(s);
+    return 1;
+  }
+  s->seq = cl->seq++ & 0xFFFFFF;
+
+  /* oldest search first */
+  for (ps = &cl->searches; *ps != NULL; ps = &(*ps)->next) {
+  }
+  *ps = s;
+  cluster_schedule(cl);
+
+  /* ^C and the deadline are only seen by polling, ranges are sent
+     again once their backoff ends */
+  while (!s->finished && *run && cl->worker_count > 0) {
+    now = cluster_now();
+    if ((expired = deadline != 0 && now >= deadline)) {
+      break;
+    }
+    cluster_schedule(cl);
+    wake = now + CLUSTER_WAIT_NS;
+    if ((retry = next_retry(cl)) != 0 && retry < wake) {
+      wake = retry;
+    }
+    ts.tv_sec = (time_t)(wake / 1000000000u);
+    ts.tv_nsec = (long)(wake % 1000000000u);
+    pthread_cond_timedwait(&cl->changed, &cl->lock, &ts);
+  }
+
+  /* stop whatever still runs for it */
+  for (ps = &cl->searches; *ps != s; ps = &(*ps)->next) {
+  }
+  *ps = s->next;
+  for (i = 0; i < CLUSTER_RANGES; i++) {
+    if (s->range[i].state == RANGE_ASSIGNED && !s->range[i].cancelled) {
+      cl->send(s->range[i].worker->peer, PROTO_CANCEL, range_id(s, i),
+               NULL, 0);
+    }
+  }
+  cluster_schedule(cl);
+  pthread_mutex_unlock(&cl->lock);
+
+  if (s->finished && s->failed) {
+    ret = 2;
+  } else if (s->finished && s->best != UINT64_MAX) {
+    *result = (uint32_t)s->best;
+    ret = 0;
+  } else {
+    ret = *run && !expired ? 1 : -1;
+  }
+  free(s);
+
+  return ret;
+}
+
+/*EOF*/
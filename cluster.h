@@ -0,0 +1,85 @@
+/**
+ * @file cluster.h
+ * @date 17 Oct 2026
+ * @brief Coordinator side of the hash server cluster mode
+ *
+ *        Worker servers register over a connection to the
+ *        coordinator.  A brute force search is cut into ranges of
+ *        candidates which are handed to the workers, a few per worker
+ *        at a time; the ranges of a worker that disappears are handed
+ *        to the others again, a range that fails is tried again a few
+ *        times with backoff.  The module does not know about sockets,
+ *        a worker is an opaque peer and requests go out through the
+ *        send callback.
+ *
+ */
+
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+
+typedef struct cluster_s cluster_t;
+
+/** @brief which match ends a search */
+typedef enum {
+  CLUSTER_LOWEST = 0,   /**< lowest candidate, like a local search */
+  CLUSTER_FIRST         /**< the first match any worker reports */
+} cluster_mode_t;
+
+/** @brief queue one frame to a worker, called with the cluster lock
+ *         held and must not block
+ */
+typedef void (*cluster_send_fn_t)(void *peer, uint16_t type, uint32_t id,
+                                  const void *payload, size_t len);
+
+/** @brief create the coordinator state
+ *
+ *  @param depth ranges in flight per worker
+ *
+ *  @retrun NULL on error
+ */
+cluster_t *cluster_create(cluster_mode_t mode, int depth,
+                          cluster_send_fn_t send);
+
+/** @brief free the state, no search may be running */
+void cluster_destroy(cluster_t *cl);
+
+/** @brief a worker registered, it gets ranges from now on */
+void cluster_worker_add(cluster_t *cl, void *peer);
+
+/** @brief a worker is gone, its ranges go to the others
+ *
+ *  The send callback is not called for peer once this returns.
+ */
+void cluster_worker_remove(cluster_t *cl, void *peer);
+
+/** @brief number of registered workers */
+int cluster_workers(cluster_t *cl);
+
+/** @brief hand a response frame of a worker to the cluster
+ *
+ *  A match that is outside the range or does not hash to the crc of
+ *  the search drops the worker like cluster_worker_remove().
+ *
+ *  @retrun 0 => ok, -1 => bad match, disconnect the worker
+ */
+int cluster_reply(cluster_t *cl, void *peer, uint32_t id, uint16_t type,
+                  const uint8_t *payload, uint32_t len);
+
+/** @brief search crc on the workers, blocks until done
+ *
+ *  @param deadline CLOCK_MONOTONIC ns to give up at, 0 => none
+ *
+ *  @retrun 0 => result is valid, 1 => no workers (search locally),
+ *          2 => a range failed on every try, -1 => aborted (run or
+ *          deadline)
+ */
+int cluster_search(cluster_t *cl, uint32_t crc, uint64_t deadline,
+                   uint32_t *result, volatile sig_atomic_t *run);
+
+#endif
+
+/*EOF*/
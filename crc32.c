@@ -41,8 +41,15 @@
  */
 
 #include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "crc32.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32_HAVE_CLMUL 1
+#include <immintrin.h>
+#endif
+
 static uint32_t crc32_tab[] = {
   0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
   0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
@@ -89,13 +96,556 @@ static uint32_t crc32_tab[] = {
   0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
 };
 
-uint32_t crc32(const void *buf, size_t size)
+/*
+ *  Slicing tables.  crc32_slice_tab[0] is crc32_tab itself, entry
+ *  crc32_slice_tab[k][n] is the CRC register after feeding byte n
+ *  followed by k zero bytes.  With them 8 (or 16) input bytes can be
+ *  folded in with independent lookups instead of a chain of byte
+ *  steps where every lookup waits for the previous one.
+ *  crc32_tab_inv maps the high byte of a crc32_tab entry back to its
+ *  index (the high bytes are all distinct), this is what makes a byte
+ *  step reversible.
+ *  The tables are generated once on first use.
+ */
+static uint32_t crc32_slice_tab[16][256];
+static uint8_t crc32_tab_inv[256];
+static pthread_once_t crc32_once = PTHREAD_ONCE_INIT;
+
+typedef uint32_t (*crc32_fn_t)(uint32_t crc, const uint8_t *p,
+                               size_t size);
+
+static uint32_t crc32_resolve(uint32_t crc, const uint8_t *p,
+                              size_t size);
+
+static crc32_fn_t crc32_impl = crc32_resolve;
+static crc32_kernel_t crc32_kernel = CRC32_KERNEL_AUTO;
+
+static void crc32_init_tables(void)
 {
-  const uint8_t *p = buf;
-  uint32_t crc = UINT32_MAX;
+  int k, n;
+
+  for (n = 0; n < 256; n++) {
+    crc32_slice_tab[0][n] = crc32_tab[n];
+    crc32_tab_inv[crc32_tab[n] >> 24] = (uint8_t)n;
+  }
 
+  for (k = 1; k < 16; k++)
+    for (n = 0; n < 256; n++)
+      crc32_slice_tab[k][n] = (crc32_slice_tab[k - 1][n] >> 8) ^
+        crc32_tab[crc32_slice_tab[k - 1][n] & 0xFF];
+}
+
+/* little endian load, compiles to a single mov on x86 */
+static inline uint32_t crc32_load_le32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | (uint32_t)p[1] << 8 |
+    (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* classic one byte at a time loop */
+static uint32_t crc32_bytewise(uint32_t crc, const uint8_t *p,
+                               size_t size)
+{
   while (size-- != 0)
     crc = crc32_tab[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
 
-  return crc ^ UINT32_MAX;
+  return crc;
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t *p,
+                             size_t size)
+{
+  const uint32_t (*t)[256] = (const uint32_t (*)[256])crc32_slice_tab;
+  uint32_t one, two;
+
+  while (size >= 8) {
+    one = crc ^ crc32_load_le32(p);
+    two = crc32_load_le32(p + 4);
+    crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+      t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+      t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^
+      t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    p += 8;
+    size -= 8;
+  }
+
+  return crc32_bytewise(crc, p, size);
+}
+
+static uint32_t crc32_slice16(uint32_t crc, const uint8_t *p,
+                              size_t size)
+{
+  const uint32_t (*t)[256] = (const uint32_t (*)[256])crc32_slice_tab;
+  uint32_t one, two, three, four;
+
+  while (size >= 16) {
+    one = crc ^ crc32_load_le32(p);
+    two = crc32_load_le32(p + 4);
+    three = crc32_load_le32(p + 8);
+    four = crc32_load_le32(p + 12);
+    crc = t[15][one & 0xFF] ^ t[14][(one >> 8) & 0xFF] ^
+      t[13][(one >> 16) & 0xFF] ^ t[12][one >> 24] ^
+      t[11][two & 0xFF] ^ t[10][(two >> 8) & 0xFF] ^
+      t[9][(two >> 16) & 0xFF] ^ t[8][two >> 24] ^
+      t[7][three & 0xFF] ^ t[6][(three >> 8) & 0xFF] ^
+      t[5][(three >> 16) & 0xFF] ^ t[4][three >> 24] ^
+      t[3][four & 0xFF] ^ t[2][(four >> 8) & 0xFF] ^
+      t[1][(four >> 16) & 0xFF] ^ t[0][four >> 24];
+    p += 16;
+    size -= 16;
+  }
+
+  return crc32_slice8(crc, p, size);
+}
+
+#ifdef CRC32_HAVE_CLMUL
+/*
+ *  Carry-less multiply folding, see Intel's "Fast CRC Computation for
+ *  Generic Polynomials Using PCLMULQDQ Instruction".  The 128 bit
+ *  accumulators are folded forward over the data by multiplying with
+ *  x^(D+32) and x^(D-32) mod P (bit reflected, shifted by one) where D
+ *  is the fold distance in bits, and the final 128 bits are reduced to
+ *  32 with a Barrett reduction.  Only whole 16 byte blocks are folded,
+ *  the remaining tail goes through the table kernel.
+ */
+static const uint64_t crc32_k_2048[2] = { 0x11542778a, 0x1322d1430 };
+static const uint64_t crc32_k_512[2]  = { 0x154442bd4, 0x1c6e41596 };
+static const uint64_t crc32_k_128[2]  = { 0x1751997d0, 0x0ccaa009e };
+static const uint64_t crc32_k_64[2]   = { 0x163cd6124, 0x000000000 };
+static const uint64_t crc32_poly[2]   = { 0x1db710641, 0x1f7011641 };
+
+#define CRC32_CLMUL_TARGET  __attribute__((target("pclmul,sse4.1")))
+#define CRC32_VCLMUL_TARGET \
+  __attribute__((target("avx512f,vpclmulqdq,pclmul,sse4.1")))
+
+/* fold x forward by the distance encoded in k and add the next block */
+CRC32_CLMUL_TARGET
+static inline __m128i crc32_fold128(__m128i x, __m128i k, __m128i next)
+{
+  return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                                     _mm_clmulepi64_si128(x, k, 0x11)),
+                       next);
+}
+
+/* fold the remaining 16 byte blocks into x and reduce to 32 bits */
+CRC32_CLMUL_TARGET
+static uint32_t crc32_clmul_reduce(__m128i x, const uint8_t *p,
+                                   size_t size)
+{
+  __m128i k = _mm_loadu_si128((const __m128i *)crc32_k_128);
+  __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i t;
+
+  while (size >= 16) {
+    x = crc32_fold128(x, k, _mm_loadu_si128((const __m128i *)p));
+    p += 16;
+    size -= 16;
+  }
+
+  /* 128 -> 64 bits */
+  t = _mm_clmulepi64_si128(x, k, 0x10);
+  x = _mm_xor_si128(_mm_srli_si128(x, 8), t);
+
+  /* 64 -> 32 bits */
+  k = _mm_loadu_si128((const __m128i *)crc32_k_64);
+  t = _mm_srli_si128(x, 4);
+  x = _mm_clmulepi64_si128(_mm_and_si128(x, mask), k, 0x00);
+  x = _mm_xor_si128(x, t);
+
+  /* Barrett reduction */
+  k = _mm_loadu_si128((const __m128i *)crc32_poly);
+  t = _mm_clmulepi64_si128(_mm_and_si128(x, mask), k, 0x10);
+  t = _mm_clmulepi64_si128(_mm_and_si128(t, mask), k, 0x00);
+  x = _mm_xor_si128(x, t);
+
+  return (uint32_t)_mm_extract_epi32(x, 1);
+}
+
+/* four 128 bit lanes folded 64 bytes at a time */
+CRC32_CLMUL_TARGET
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t *p,
+                             size_t size)
+{
+  __m128i x0, x1, x2, x3, k;
+  size_t blocks;
+
+  if (size < 64)
+    return crc32_slice16(crc, p, size);
+
+  blocks = size & ~(size_t)15;
+
+  x0 = _mm_loadu_si128((const __m128i *)(p + 0));
+  x1 = _mm_loadu_si128((const __m128i *)(p + 16));
+  x2 = _mm_loadu_si128((const __m128i *)(p + 32));
+  x3 = _mm_loadu_si128((const __m128i *)(p + 48));
+  x0 = _mm_xor_si128(x0, _mm_cvtsi32_si128((int)crc));
+  p += 64;
+  size -= 64;
+  blocks -= 64;
+
+  k = _mm_loadu_si128((const __m128i *)crc32_k_512);
+  while (blocks >= 64) {
+    x0 = crc32_fold128(x0, k, _mm_loadu_si128((const __m128i *)(p + 0)));
+    x1 = crc32_fold128(x1, k, _mm_loadu_si128((const __m128i *)(p + 16)));
+    x2 = crc32_fold128(x2, k, _mm_loadu_si128((const __m128i *)(p + 32)));
+    x3 = crc32_fold128(x3, k, _mm_loadu_si128((const __m128i *)(p + 48)));
+    p += 64;
+    size -= 64;
+    blocks -= 64;
+  }
+
+  /* combine the four lanes */
+  k = _mm_loadu_si128((const __m128i *)crc32_k_128);
+  x1 = crc32_fold128(x0, k, x1);
+  x2 = crc32_fold128(x1, k, x2);
+  x3 = crc32_fold128(x2, k, x3);
+
+  crc = crc32_clmul_reduce(x3, p, blocks);
+  p += blocks;
+  size -= blocks;
+
+  return crc32_slice16(crc, p, size);
+}
+
+/* AVX-512 variant, four 512 bit registers folded 256 bytes at a time */
+CRC32_VCLMUL_TARGET
+static uint32_t crc32_vpclmul(uint32_t crc, const uint8_t *p,
+                              size_t size)
+{
+  __m512i z0, z1, z2, z3, k;
+  __m128i x0, x1, x2, x3, k128;
+
+  if (size < 256)
+    return crc32_pclmul(crc, p, size);
+
+  z0 = _mm512_loadu_si512((const void *)(p + 0));
+  z1 = _mm512_loadu_si512((const void *)(p + 64));
+  z2 = _mm512_loadu_si512((const void *)(p + 128));
+  z3 = _mm512_loadu_si512((const void *)(p + 192));
+  z0 = _mm512_xor_si512(z0, _mm512_zextsi128_si512(
+                          _mm_cvtsi32_si128((int)crc)));
+  p += 256;
+  size -= 256;
+
+#define CRC32_FOLD512(z, k, next) \
+  _mm512_ternarylogic_epi64(_mm512_clmulepi64_epi128(z, k, 0x00), \
+                            _mm512_clmulepi64_epi128(z, k, 0x11), \
+                            next, 0x96)
+
+  k = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i *)crc32_k_2048));
+  while (size >= 256) {
+    z0 = CRC32_FOLD512(z0, k, _mm512_loadu_si512((const void *)(p + 0)));
+    z1 = CRC32_FOLD512(z1, k, _mm512_loadu_si512((const void *)(p + 64)));
+    z2 = CRC32_FOLD512(z2, k, _mm512_loadu_si512((const void *)(p + 128)));
+    z3 = CRC32_FOLD512(z3, k, _mm512_loadu_si512((const void *)(p + 192)));
+    p += 256;
+    size -= 256;
+  }
+
+  /* combine the four registers, then keep folding 64 bytes at a time */
+  k = _mm512_broadcast_i32x4(
+        _mm_loadu_si128((const __m128i *)crc32_k_512));
+  z1 = CRC32_FOLD512(z0, k, z1);
+  z2 = CRC32_FOLD512(z1, k, z2);
+  z3 = CRC32_FOLD512(z2, k, z3);
+  while (size >= 64) {
+    z3 = CRC32_FOLD512(z3, k, _mm512_loadu_si512((const void *)p));
+    p += 64;
+    size -= 64;
+  }
+
+#undef CRC32_FOLD512
+
+  /* combine the four 128 bit lanes */
+  k128 = _mm_loadu_si128((const __m128i *)crc32_k_128);
+  x0 = _mm512_extracti32x4_epi32(z3, 0);
+  x1 = _mm512_extracti32x4_epi32(z3, 1);
+  x2 = _mm512_extracti32x4_epi32(z3, 2);
+  x3 = _mm512_extracti32x4_epi32(z3, 3);
+  x1 = crc32_fold128(x0, k128, x1);
+  x2 = crc32_fold128(x1, k128, x2);
+  x3 = crc32_fold128(x2, k128, x3);
+
+  crc = crc32_clmul_reduce(x3, p, size & ~(size_t)15);
+  p += size & ~(size_t)15;
+  size &= 15;
+
+  return crc32_slice16(crc, p, size);
+}
+
+static int crc32_cpu_has_pclmul(void)
+{
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("pclmul") &&
+    __builtin_cpu_supports("sse4.1");
+}
+
+static int crc32_cpu_has_vpclmul(void)
+{
+  return crc32_cpu_has_pclmul() &&
+    __builtin_cpu_supports("avx512f") &&
+    __builtin_cpu_supports("vpclmulqdq");
+}
+#endif
+
+/* map a kernel id to its function, AUTO picks the fastest one */
+static crc32_fn_t crc32_lookup(crc32_kernel_t kernel)
+{
+  switch (kernel) {
+  case CRC32_KERNEL_BYTEWISE:
+    return crc32_bytewise;
+  case CRC32_KERNEL_SLICE8:
+    return crc32_slice8;
+  case CRC32_KERNEL_SLICE16:
+    return crc32_slice16;
+  case CRC32_KERNEL_PCLMUL:
+#ifdef CRC32_HAVE_CLMUL
+    if (crc32_cpu_has_pclmul())
+      return crc32_pclmul;
+#endif
+    return NULL;
+  case CRC32_KERNEL_VPCLMUL:
+#ifdef CRC32_HAVE_CLMUL
+    if (crc32_cpu_has_vpclmul())
+      return crc32_vpclmul;
+#endif
+    return NULL;
+  case CRC32_KERNEL_AUTO:
+#ifdef CRC32_HAVE_CLMUL
+    if (crc32_cpu_has_vpclmul())
+      return crc32_vpclmul;
+    if (crc32_cpu_has_pclmul())
+      return crc32_pclmul;
+#endif
+    return crc32_slice16;
+  }
+
+  return NULL;
+}
+
+/* first call: build the tables, then publish the selected kernel */
+static uint32_t crc32_resolve(uint32_t crc, const uint8_t *p,
+                              size_t size)
+{
+  crc32_fn_t fn;
+
+  pthread_once(&crc32_once, crc32_init_tables);
+  fn = crc32_lookup(__atomic_load_n(&crc32_kernel, __ATOMIC_RELAXED));
+  __atomic_store_n(&crc32_impl, fn, __ATOMIC_RELEASE);
+
+  return fn(crc, p, size);
+}
+
+int crc32_set_kernel(crc32_kernel_t kernel)
+{
+  crc32_fn_t fn = crc32_lookup(kernel);
+
+  if (fn == NULL)
+    return -1;
+
+  pthread_once(&crc32_once, crc32_init_tables);
+  __atomic_store_n(&crc32_kernel, kernel, __ATOMIC_RELAXED);
+  __atomic_store_n(&crc32_impl, fn, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+crc32_kernel_t crc32_get_kernel(void)
+{
+  return __atomic_load_n(&crc32_kernel, __ATOMIC_RELAXED);
+}
+
+const char *crc32_kernel_name(crc32_kernel_t kernel)
+{
+  switch (kernel) {
+  case CRC32_KERNEL_AUTO:
+    return "auto";
+  case CRC32_KERNEL_BYTEWISE:
+    return "bytewise";
+  case CRC32_KERNEL_SLICE8:
+    return "slice8";
+  case CRC32_KERNEL_SLICE16:
+    return "slice16";
+  case CRC32_KERNEL_PCLMUL:
+    return "pclmul";
+  case CRC32_KERNEL_VPCLMUL:
+    return "vpclmul";
+  }
+
+  return "unknown";
+}
+
+uint32_t crc32(const void *buf, size_t size)
+{
+  return crc32_final(crc32_update(CRC32_INIT, buf, size));
+}
+
+uint32_t crc32_update(uint32_t state, const void *buf, size_t size)
+{
+  crc32_fn_t fn = __atomic_load_n(&crc32_impl, __ATOMIC_ACQUIRE);
+
+  return fn(state, buf, size);
+}
+
+uint32_t crc32_final(uint32_t state)
+{
+  return state ^ UINT32_MAX;
+}
+
+/*
+ *  Walking backwards: after a step s' = tab[j] ^ (s >> 8) with
+ *  j = (s ^ byte) & 0xFF the high byte of s' is the high byte of
+ *  tab[j], which identifies j, and then s = ((s' ^ tab[j]) << 8) |
+ *  (j ^ byte).
+ */
+uint32_t crc32_rewind(uint32_t state, const void *buf, size_t size)
+{
+  const uint8_t *p = (const uint8_t *)buf + size;
+  uint8_t j;
+
+  pthread_once(&crc32_once, crc32_init_tables);
+
+  while (size-- != 0) {
+    j = crc32_tab_inv[state >> 24];
+    state = ((state ^ crc32_tab[j]) << 8) | (uint8_t)(j ^ *--p);
+  }
+
+  return state;
+}
+
+/*
+ *  crc32_combine() is the GF(2) matrix method from zlib: appending a
+ *  zero bit to the message is a linear operator on the CRC register,
+ *  so appending len2 zero bytes is that operator raised to the power
+ *  8*len2, computed by repeated squaring in O(log len2).
+ */
+#define GF2_DIM 32
+
+static uint32_t gf2_matrix_times(const uint32_t *mat, uint32_t vec)
+{
+  uint32_t sum = 0;
+
+  while (vec) {
+    if (vec & 1)
+      sum ^= *mat;
+    vec >>= 1;
+    mat++;
+  }
+
+  return sum;
+}
+
+static void gf2_matrix_square(uint32_t *square, const uint32_t *mat)
+{
+  int n;
+
+  for (n = 0; n < GF2_DIM; n++)
+    square[n] = gf2_matrix_times(mat, mat[n]);
+}
+
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2)
+{
+  uint32_t even[GF2_DIM];   /* even-power-of-two zeros operator */
+  uint32_t odd[GF2_DIM];    /* odd-power-of-two zeros operator */
+  uint32_t row;
+  int n;
+
+  if (len2 == 0)
+    return crc1;
+
+  /* operator for one zero bit in odd */
+  odd[0] = 0xedb88320;
+  row = 1;
+  for (n = 1; n < GF2_DIM; n++) {
+    odd[n] = row;
+    row <<= 1;
+  }
+
+  gf2_matrix_square(even, odd);   /* two zero bits */
+  gf2_matrix_square(odd, even);   /* four zero bits */
+
+  /* apply len2 zero bytes to crc1, first square puts the operator
+     for one zero byte (eight zero bits) in even */
+  do {
+    gf2_matrix_square(even, odd);
+    if (len2 & 1)
+      crc1 = gf2_matrix_times(even, crc1);
+    len2 >>= 1;
+    if (len2 == 0)
+      break;
+
+    gf2_matrix_square(odd, even);
+    if (len2 & 1)
+      crc1 = gf2_matrix_times(odd, crc1);
+    len2 >>= 1;
+  } while (len2 != 0);
+
+  return crc1 ^ crc2;
+}
+
+/*
+ *  crc32_parallel() splits the buffer into one slice per thread, every
+ *  thread computes the CRC of its slice and the partial results are
+ *  merged in order with crc32_combine().
+ */
+#define CRC32_PARALLEL_MIN_SLICE  (1024 * 1024)
+#define CRC32_PARALLEL_MAX_THREADS 64
+
+typedef struct crc32_slice_job_s {
+  const uint8_t *buf;
+  size_t size;
+  uint32_t crc;
+} crc32_slice_job_t;
+
+static void *crc32_slice_thread(void *ptr)
+{
+  crc32_slice_job_t *job = ptr;
+
+  job->crc = crc32(job->buf, job->size);
+
+  return NULL;
+}
+
+uint32_t crc32_parallel(const void *buf, size_t size, int threads)
+{
+  crc32_slice_job_t job[CRC32_PARALLEL_MAX_THREADS];
+  pthread_t tid[CRC32_PARALLEL_MAX_THREADS];
+  int started[CRC32_PARALLEL_MAX_THREADS];
+  const uint8_t *p = buf;
+  size_t slice;
+  uint32_t crc;
+  int i;
+
+  if (threads <= 0)
+    threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (threads > CRC32_PARALLEL_MAX_THREADS)
+    threads = CRC32_PARALLEL_MAX_THREADS;
+  /* not worth a thread below a minimum slice size */
+  if ((size_t)threads > size / CRC32_PARALLEL_MIN_SLICE)
+    threads = (int)(size / CRC32_PARALLEL_MIN_SLICE);
+  if (threads <= 1)
+    return crc32(buf, size);
+
+  slice = size / threads;
+  for (i = 0; i < threads; i++) {
+    job[i].buf = p + slice * i;
+    job[i].size = (i == threads - 1) ? size - slice * i : slice;
+    /* slice 0 runs on the calling thread */
+    started[i] = (i > 0) &&
+      pthread_create(&tid[i], NULL, crc32_slice_thread, &job[i]) == 0;
+  }
+
+  for (i = 0; i < threads; i++) {
+    if (started[i])
+      pthread_join(tid[i], NULL);
+    else
+      crc32_slice_thread(&job[i]);
+  }
+
+  crc = job[0].crc;
+  for (i = 1; i < threads; i++)
+    crc = crc32_combine(crc, job[i].crc, job[i].size);
+
+  return crc;
 }
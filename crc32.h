@@ -4,7 +4,59 @@
 
 
 #include <stdlib.h>
+#include <stdint.h>
+
+/** @brief available crc32 kernels, all produce identical results
+ *
+ *  CRC32_KERNEL_AUTO selects the fastest kernel for this machine,
+ *  the carry-less multiply kernels are only available if the CPU
+ *  supports PCLMULQDQ (resp. AVX-512 VPCLMULQDQ).
+ */
+typedef enum crc32_kernel_e {
+  CRC32_KERNEL_AUTO = 0,
+  CRC32_KERNEL_BYTEWISE,
+  CRC32_KERNEL_SLICE8,
+  CRC32_KERNEL_SLICE16,
+  CRC32_KERNEL_PCLMUL,
+  CRC32_KERNEL_VPCLMUL
+} crc32_kernel_t;
+
+/** @brief initial register value for crc32_update() */
+#define CRC32_INIT  UINT32_MAX
 
 uint32_t crc32(const void *buf, size_t size);
 
+/** @brief incremental interface
+ *
+ *  crc32(buf, size) == crc32_final(crc32_update(CRC32_INIT, buf, size)),
+ *  the state may be fed any number of consecutive pieces in between.
+ */
+uint32_t crc32_update(uint32_t state, const void *buf, size_t size);
+uint32_t crc32_final(uint32_t state);
+
+/** @brief inverse of crc32_update()
+ *
+ *  Returns the register state before buf was fed, i.e.
+ *  crc32_rewind(crc32_update(s, buf, size), buf, size) == s.
+ */
+uint32_t crc32_rewind(uint32_t state, const void *buf, size_t size);
+
+/** @brief crc32 of A followed by B from crc32(A), crc32(B) and len(B)
+ */
+uint32_t crc32_combine(uint32_t crc1, uint32_t crc2, size_t len2);
+
+/** @brief crc32 of a large buffer computed by several threads
+ *
+ *  @param threads number of threads, <= 0 uses all online CPUs
+ */
+uint32_t crc32_parallel(const void *buf, size_t size, int threads);
+
+/** @brief select the kernel used by crc32()
+ *
+ *  @retrun 0 on success, -1 if the kernel is not available
+ */
+int crc32_set_kernel(crc32_kernel_t kernel);
+crc32_kernel_t crc32_get_kernel(void);
+const char *crc32_kernel_name(crc32_kernel_t kernel);
+
 #endif
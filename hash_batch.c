@@ -0,0 +1,343 @@
+/**
+ * @file hash_batch.c
+ * @date 17 Oct 2026
+ * @brief Offline collision search for every line of a file
+ *
+ *        The input is mapped into memory and cut into chunks at line
+ *        boundaries.  The chunks go to a thread pool, every worker
+ *        hashes and cracks the lines of its chunk into a buffer of its
+ *        own, the main thread writes the buffers in input order, so
+ *        the output matches the stream mode of hash_client:
+ *        "0x%08x<TAB>line".  At most window chunks are in flight, the
+ *        memory needed does not depend on the size of the input.
+ *
+ * @usage gcc -std=c99 -O2 hash_batch.c crc32.c hash_crack.c thread_pool.c
+ *            -o hash_batch -Wall -pedantic-errors -lpthread -fopenmp
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#define _POSIX_C_SOURCE     200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "crc32.h"
+#include "hash_crack.h"
+#include "thread_pool.h"
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define DEFAULT_CHUNK_KB    1024
+#define CHUNKS_PER_WORKER   4
+#define OUT_PREFIX          11      /* "0x%08x\t" */
+#define OUT_BUF             (1u << 20)
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+
+/* one chunk of input lines and its output, out is valid once done */
+typedef struct chunk_s {
+  const char *begin;
+  const char *end;
+  char *out;
+  size_t out_len;
+  size_t lines;
+  int done;
+  int failed;
+} chunk_t;
+
+/* job of the thread pool, chunks live in the window of main() */
+typedef struct batch_job_s {
+  chunk_t *chunk;
+} batch_job_t;
+
+/*****************************************************************************/
+/******************************************************************* globals */
+volatile sig_atomic_t run = 1;
+static crack_opts_t crack_opts = { CRACK_ENGINE_SOLVE, 1, 0 };
+
+/* workers report finished chunks to main() */
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal monotonic clock in s
+ *
+ */
+static double now_sec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** @internal write "0x%08x\t" to out, faster than sprintf()
+ *
+ */
+static void put_hex(char *out, uint32_t v)
+{
+  static const char digits[] = "0123456789abcdef";
+  int i;
+
+  out[0] = '0';
+  out[1] = 'x';
+  for (i = 9; i >= 2; i--) {
+    out[i] = digits[v & 0xF];
+    v >>= 4;
+  }
+  out[10] = '\t';
+}
+
+/** @internal crack every line of a chunk, executed by a pool worker
+ *
+ */
+static void batch_worker(void *ptr)
+{
+  chunk_t *ch = ((batch_job_t *)ptr)->chunk;
+  const char *line, *eol;
+  size_t lines = 0, n = 0, len;
+  uint32_t result;
+  char *out;
+
+  /* exact size of the output: every line gets the prefix and a
+     newline, also the last one if it has none */
+  for (line = ch->begin; line < ch->end; line = eol + 1, n++) {
+    if ((eol = memchr(line, '\n', ch->end - line)) == NULL) {
+      eol = ch->end;
+    }
+  }
+  if ((out = malloc((ch->end - ch->begin) + n * (OUT_PREFIX + 1))) ==
+      NULL) {
+    ch->failed = 1;
+    goto out;
+  }
+  ch->out = out;
+
+  for (line = ch->begin; line < ch->end && run; line = eol + 1) {
+    if ((eol = memchr(line, '\n', ch->end - line)) == NULL) {
+      eol = ch->end;
+    }
+    len = eol - line;
+    if (len > 0 && line[len - 1] == '\r') {
+      len--;
+    }
+
+    /* return if ^C */
+    if (crack_search(crc32(line, len), &crack_opts, &result, &run) != 0) {
+      break;
+    }
+    put_hex(out, result);
+    memcpy(out + OUT_PREFIX, line, len);
+    out[OUT_PREFIX + len] = '\n';
+    out += OUT_PREFIX + len + 1;
+    lines++;
+  }
+  ch->out_len = out - ch->out;
+  ch->lines = lines;
+  ch->failed = line < ch->end;
+
+out:
+  pthread_mutex_lock(&done_lock);
+  ch->done = 1;
+  pthread_cond_broadcast(&done_cond);
+  pthread_mutex_unlock(&done_lock);
+}
+
+/** @internal end of the chunk starting at begin: the first line end
+ *            after size bytes
+ *
+ */
+static const char *chunk_end(const char *begin, const char *end,
+                             size_t size)
+{
+  const char *eol;
+
+  if ((size_t)(end - begin) <= size) {
+    return end;
+  }
+  if ((eol = memchr(begin + size, '\n', end - begin - size)) == NULL) {
+    return end;
+  }
+
+  return eol + 1;
+}
+
+/** @internal print usage of program
+ *
+ */
+static void print_usage(void)
+{
+  printf("\n  Hash cracker batch 1.0\n\n");
+  printf("\nUsage:\n------\n");
+  printf("          hash_batch [-o output] [-m engine] [-w workers]"
+         " [-c chunk KB]\n"
+         "                     [-t threads] [-h] input\n\n");
+}
+
+/** @brief ctrc handler
+ *
+ */
+void cntrl_c_handler(int ignored)
+{
+
+  run = 0;
+}
+
+/** @brief main function for the batch tool
+ *
+ */
+int main(int argc, char *argv[])
+{
+  thread_pool_t *pool;
+  batch_job_t *job;
+  chunk_t *window, *ch;
+  struct stat st;
+  FILE *fp = stdout;
+  char *out = NULL;
+  const char *data = NULL, *pos, *end;
+  size_t chunk_size = (size_t)DEFAULT_CHUNK_KB << 10;
+  size_t nwindow, head = 0, tail = 0, lines = 0;
+  double start, elapsed;
+  int option, fd, workers = 0, failed = 0;
+
+  while ((option = getopt(argc, argv, "o:m:w:c:t:h")) != -1) {
+    switch (option) {
+    case 'o':
+      out = optarg;
+      break;
+    case 'm':
+      if (crack_engine_parse(optarg, &crack_opts.engine) != 0) {
+        print_usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'w':
+      workers = atoi(optarg);
+      break;
+    case 'c':
+      chunk_size = strtoul(optarg, NULL, 0) << 10;
+      break;
+    case 't':
+      crack_opts.threads = atoi(optarg);
+      break;
+    case 'h':
+    default:
+      print_usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (optind != argc - 1) {
+    print_usage();
+    exit(EXIT_FAILURE);
+  }
+  if (chunk_size == 0) {
+    chunk_size = (size_t)DEFAULT_CHUNK_KB << 10;
+  }
+
+  signal(SIGINT, cntrl_c_handler);
+
+  /* map the whole input, the kernel reads ahead for us */
+  if ((fd = open(argv[optind], O_RDONLY)) < 0 || fstat(fd, &st) < 0) {
+    perror(argv[optind]);
+    exit(EXIT_FAILURE);
+  }
+  if (st.st_size > 0) {
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      perror("mmap");
+      exit(EXIT_FAILURE);
+    }
+    posix_madvise((void *)data, (size_t)st.st_size,
+                  POSIX_MADV_SEQUENTIAL);
+  }
+  close(fd);
+
+  if (out != NULL && (fp = fopen(out, "w")) == NULL) {
+    perror(out);
+    exit(EXIT_FAILURE);
+  }
+  setvbuf(fp, NULL, _IOFBF, OUT_BUF);
+
+  /* window chunks in flight, the pool queue holds all of them */
+  if (workers <= 0) {
+    workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  }
+  workers = workers > 0 ? workers : 1;
+  nwindow = (size_t)workers * CHUNKS_PER_WORKER;
+  if ((pool = thread_pool_create(workers, nwindow, sizeof(batch_job_t),
+                                 batch_worker)) == NULL ||
+      (window = calloc(nwindow, sizeof(*window))) == NULL) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+
+  start = now_sec();
+  pos = data;
+  end = data != NULL ? data + st.st_size : NULL;
+  while (head != tail || (pos < end && run)) {
+    /* fill the window */
+    while (pos < end && run && tail - head < nwindow &&
+           (job = thread_pool_job_get(pool)) != NULL) {
+      ch = &window[tail++ % nwindow];
+      memset(ch, 0, sizeof(*ch));
+      ch->begin = pos;
+      ch->end = pos = chunk_end(pos, end, chunk_size);
+      job->chunk = ch;
+      thread_pool_submit(pool, job);
+    }
+
+    /* write the oldest chunk as soon as it is done */
+    ch = &window[head % nwindow];
+    pthread_mutex_lock(&done_lock);
+    while (!ch->done) {
+      pthread_cond_wait(&done_cond, &done_lock);
+    }
+    pthread_mutex_unlock(&done_lock);
+
+    if (ch->out_len > 0 && fwrite(ch->out, 1, ch->out_len, fp) !=
+        ch->out_len) {
+      perror("fwrite");
+      run = 0;
+    }
+    failed |= ch->failed;
+    lines += ch->lines;
+    free(ch->out);
+    head++;
+  }
+  fflush(fp);
+  elapsed = now_sec() - start;
+
+  thread_pool_destroy(pool);
+  free(window);
+  if (data != NULL) {
+    munmap((void *)data, (size_t)st.st_size);
+  }
+  if (fp != stdout) {
+    fclose(fp);
+  }
+
+  fprintf(stderr, "%zu lines in %.3f s, %.0f lines/s, %.1f MB/s (%d "
+          "workers, %s)\n", lines, elapsed,
+          lines / (elapsed > 0 ? elapsed : 1e-9),
+          st.st_size / 1e6 / (elapsed > 0 ? elapsed : 1e-9),
+          workers, crack_engine_name(crack_opts.engine));
+
+  return failed || !run ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*EOF*/
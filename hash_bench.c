@@ -0,0 +1,341 @@
+/**
+ * @file hash_bench.c
+ * @date 17 Oct 2026
+ * @brief Microbenchmarks for crc32 and the collision search
+ *
+ *        Measures crc32() throughput of every kernel available on this
+ *        machine for buffer sizes from 16 B to 64 MB, and the time
+ *        every search engine needs for a fixed set of target crcs.
+ *        Results go to stdout or a file as CSV or JSON, one record per
+ *        measurement, so runs of different builds can be compared.
+ *
+ * @usage gcc -std=c99 -O2 hash_bench.c crc32.c hash_crack.c
+ *            -o hash_bench -Wall -pedantic-errors -lpthread -fopenmp
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#define _POSIX_C_SOURCE     200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <getopt.h>
+#include <signal.h>
+#include <time.h>
+#include "crc32.h"
+#include "hash_crack.h"
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define MIN_SIZE            16
+#define DEFAULT_MAX_SIZE    (64u << 20)
+#define DEFAULT_MIN_TIME    0.2
+#define SOLVE_ROUNDS        100000
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef enum {
+  FORMAT_CSV = 0,
+  FORMAT_JSON
+} format_t;
+
+/* one measurement */
+typedef struct record_s {
+  const char *kind;
+  const char *name;
+  char param[16];
+  uint64_t iterations;
+  double ns_per_op;
+  double throughput;
+  const char *unit;
+} record_t;
+
+/*****************************************************************************/
+/******************************************************************* globals */
+volatile sig_atomic_t run = 1;
+
+/* the search targets: crcs of well known strings (solver only, a scan
+   may need all 2^32 candidates for them) and of candidates at
+   increasing depth of the scan, so brute force times stay bounded */
+static const char *target_str[] = { "test", "hash cracker" };
+static const uint32_t target_idx[] = {
+  0x00100000, 0x01000000, 0x04000000
+};
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal monotonic clock in s
+ *
+ */
+static double now_sec(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** @internal write one record
+ *
+ */
+static void emit(FILE *fp, format_t format, const record_t *r, int first)
+{
+  if (format == FORMAT_CSV) {
+    fprintf(fp, "%s,%s,%s,%"PRIu64",%.2f,%.4f,%s\n", r->kind, r->name,
+            r->param, r->iterations, r->ns_per_op, r->throughput,
+            r->unit);
+  } else {
+    fprintf(fp, "%s    {\"kind\": \"%s\", \"name\": \"%s\", "
+            "\"param\": \"%s\", \"iterations\": %"PRIu64", "
+            "\"ns_per_op\": %.2f, \"throughput\": %.4f, "
+            "\"unit\": \"%s\"}", first ? "" : ",\n", r->kind, r->name,
+            r->param, r->iterations, r->ns_per_op, r->throughput,
+            r->unit);
+  }
+  fflush(fp);
+}
+
+/** @internal crc32() of size bytes, repeated for at least min_time
+ *
+ */
+static void bench_crc32(record_t *r, const uint8_t *buf, size_t size,
+                        double min_time, int threads)
+{
+  volatile uint32_t sink = 0;
+  uint64_t iter = 0;
+  double start, elapsed;
+
+  start = now_sec();
+  do {
+    sink ^= threads ? crc32_parallel(buf, size, threads) :
+            crc32(buf, size);
+    iter++;
+  } while ((elapsed = now_sec() - start) < min_time);
+  (void)sink;
+
+  sprintf(r->param, "%zu", size);
+  r->iterations = iter;
+  r->ns_per_op = elapsed * 1e9 / iter;
+  r->throughput = size * (double)iter / elapsed / 1e9;
+  r->unit = "GB/s";
+}
+
+/** @internal crack_search() of one target with one engine
+ *
+ *  Scans report candidates/s up to the match, the solver calls/s.
+ */
+static int bench_crack(record_t *r, uint32_t crc, crack_engine_t engine,
+                       int threads)
+{
+  crack_opts_t opts;
+  uint32_t result = 0;
+  uint64_t i, iter = 1;
+  double start, elapsed;
+
+  opts.engine = engine;
+  opts.threads = threads;
+  opts.deadline = 0;
+
+  start = now_sec();
+  if (engine == CRACK_ENGINE_SOLVE) {
+    for (i = 0; i < SOLVE_ROUNDS; i++) {
+      if (crack_search(crc ^ (uint32_t)i, &opts, &result, &run) != 0) {
+        return -1;
+      }
+    }
+    iter = SOLVE_ROUNDS;
+  } else if (crack_search(crc, &opts, &result, &run) != 0) {
+    return -1;
+  }
+  elapsed = now_sec() - start;
+
+  sprintf(r->param, "0x%08"PRIx32, crc);
+  r->iterations = iter;
+  r->ns_per_op = elapsed * 1e9 / iter;
+  if (engine == CRACK_ENGINE_SOLVE) {
+    r->throughput = iter / elapsed / 1e6;
+    r->unit = "Mops/s";
+  } else {
+    r->throughput = (result + 1.0) / elapsed / 1e6;
+    r->unit = "Mcand/s";
+  }
+
+  return 0;
+}
+
+/** @internal print usage of program
+ *
+ */
+static void print_usage(void)
+{
+  printf("\n  Hash cracker benchmark 1.0\n\n");
+  printf("\nUsage:\n------\n");
+  printf("          hash_bench [-f csv|json] [-o file] [-s max size]"
+         " [-m min time]\n"
+         "                     [-t threads] [-x crc32|crack] [-h]\n\n");
+}
+
+/** @brief ctrc handler
+ *
+ */
+void cntrl_c_handler(int ignored)
+{
+
+  run = 0;
+}
+
+/** @brief main function for the benchmark
+ *
+ */
+int main(int argc, char *argv[])
+{
+  static const crc32_kernel_t kernels[] = {
+    CRC32_KERNEL_AUTO, CRC32_KERNEL_BYTEWISE, CRC32_KERNEL_SLICE8,
+    CRC32_KERNEL_SLICE16, CRC32_KERNEL_PCLMUL, CRC32_KERNEL_VPCLMUL
+  };
+  static const crack_engine_t engines[] = {
+    CRACK_ENGINE_SOLVE, CRACK_ENGINE_BRUTE, CRACK_ENGINE_SIMD,
+    CRACK_ENGINE_GRAY
+  };
+  format_t format = FORMAT_CSV;
+  FILE *fp = stdout;
+  char *out = NULL;
+  uint8_t *buf;
+  uint8_t in[4];
+  record_t r;
+  size_t size, max_size = DEFAULT_MAX_SIZE, k, t;
+  double min_time = DEFAULT_MIN_TIME;
+  int option, threads = 1, first = 1;
+  int do_crc = 1, do_crack = 1;
+  uint32_t crc;
+
+  while ((option = getopt(argc, argv, "f:o:s:m:t:x:h")) != -1) {
+    switch (option) {
+    case 'f':
+      if (strcmp(optarg, "csv") == 0) {
+        format = FORMAT_CSV;
+      } else if (strcmp(optarg, "json") == 0) {
+        format = FORMAT_JSON;
+      } else {
+        print_usage();
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'o':
+      out = optarg;
+      break;
+    case 's':
+      max_size = strtoul(optarg, NULL, 0);
+      break;
+    case 'm':
+      min_time = atof(optarg);
+      break;
+    case 't':
+      threads = atoi(optarg);
+      break;
+    case 'x':
+      do_crc = strcmp(optarg, "crc32") == 0;
+      do_crack = strcmp(optarg, "crack") == 0;
+      break;
+    case 'h':
+    default:
+      print_usage();
+      exit(EXIT_FAILURE);
+    }
+  }
+  if (max_size < MIN_SIZE) {
+    max_size = MIN_SIZE;
+  }
+
+  signal(SIGINT, cntrl_c_handler);
+
+  if (out != NULL && (fp = fopen(out, "w")) == NULL) {
+    perror(out);
+    exit(EXIT_FAILURE);
+  }
+  if ((buf = malloc(max_size)) == NULL) {
+    perror("malloc");
+    exit(EXIT_FAILURE);
+  }
+  /* not all zero, some kernels might shortcut that one day */
+  for (size = 0; size < max_size; size++) {
+    buf[size] = (uint8_t)(size * 2654435761u >> 24);
+  }
+
+  if (format == FORMAT_CSV) {
+    fprintf(fp, "kind,name,param,iterations,ns_per_op,throughput,unit\n");
+  } else {
+    fprintf(fp, "{\n  \"simd\": \"%s\",\n  \"threads\": %d,\n"
+            "  \"results\": [\n", crack_simd_name(), threads);
+  }
+
+  /* crc32 kernels (auto = what crc32() picks by default), every size
+     4x the previous one */
+  for (k = 0; do_crc && run && k < sizeof(kernels) / sizeof(*kernels);
+       k++) {
+    if (crc32_set_kernel(kernels[k]) != 0) {
+      continue;
+    }
+    for (size = MIN_SIZE; run && size <= max_size; size *= 4) {
+      r.kind = "crc32";
+      r.name = crc32_kernel_name(kernels[k]);
+      bench_crc32(&r, buf, size, min_time, 0);
+      emit(fp, format, &r, first);
+      first = 0;
+    }
+  }
+  crc32_set_kernel(CRC32_KERNEL_AUTO);
+
+  /* the multithreaded split only pays off for large buffers */
+  for (size = 1u << 20; do_crc && run && threads != 1 &&
+       size <= max_size; size *= 4) {
+    r.kind = "crc32";
+    r.name = "parallel";
+    bench_crc32(&r, buf, size, min_time, threads);
+    emit(fp, format, &r, first);
+    first = 0;
+  }
+
+  /* collision search, end to end */
+  for (k = 0; do_crack && run && k < sizeof(engines) / sizeof(*engines);
+       k++) {
+    for (t = 0; run && t < sizeof(target_str) / sizeof(*target_str) +
+         sizeof(target_idx) / sizeof(*target_idx); t++) {
+      if (t < sizeof(target_str) / sizeof(*target_str)) {
+        if (engines[k] != CRACK_ENGINE_SOLVE) {
+          continue;
+        }
+        crc = crc32(target_str[t], strlen(target_str[t]));
+      } else {
+        crack_candidate_bytes(target_idx[t - sizeof(target_str) /
+                                         sizeof(*target_str)], in);
+        crc = crc32(in, sizeof(in));
+      }
+      r.kind = "crack";
+      r.name = crack_engine_name(engines[k]);
+      if (bench_crack(&r, crc, engines[k], threads) == 0) {
+        emit(fp, format, &r, first);
+        first = 0;
+      }
+    }
+  }
+
+  if (format == FORMAT_JSON) {
+    fprintf(fp, "\n  ]\n}\n");
+  }
+
+  free(buf);
+  if (fp != stdout) {
+    fclose(fp);
+  }
+
+  return run ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*EOF*/
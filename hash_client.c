@@ -4,16 +4,21 @@
  * @date 1 Nov 2016
  * @brief File contains client functionallity for the hash cracker client
  *
- * @usage gcc -std=c99 -o hash_client hash_client.c -Wall -pedantic -lpthread
+ * @usage gcc -std=c99 -o hash_client hash_client.c load_gen.c -Wall
+ *            -pedantic -lpthread
  *        astyle -A3 --max-code-length=79 --indent=spaces=2 hash_client.c
  *
  */
 
 /*****************************************************************************/
 /****************************************************************** includes */
-#define _POSIX_C_SOURCE     200112L
+#define _POSIX_C_SOURCE     200809L
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
@@ -24,65 +29,823 @@
 #include <errno.h>
 #include <signal.h>
 #include <pthread.h>
+#include <inttypes.h>
+#include <time.h>
 
 /* include shared defines */
 #include "shared_defines.h"
+#include "protocol.h"
+#include "load_gen.h"
 
 /*****************************************************************************/
 /******************************************************************* defines */
 #define BUF 1024
+#define MAX_KEYS 64
+#define STATS_BUF 4096
+#define DEFAULT_LOAD_CONNS 8
+#define DEFAULT_LOAD_SECS  10
+#define DEFAULT_WINDOW     256
+#define MAX_WINDOW         65536
 #define ANSI_COLOR_GREEN   "\x1b[32m"
 #define ANSI_COLOR_RESET   "\x1b[0m"
 
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef enum {
+  STREAM_FREE = 0,
+  STREAM_SENT,
+  STREAM_RETRY,     /* server was busy, send again */
+  STREAM_DONE,
+  STREAM_ERROR
+} stream_state_t;
+
+/* one line in the window of crack_stream(), slot = sequence % window */
+typedef struct stream_entry_s {
+  char *line;
+  uint32_t result;
+  uint32_t sent;        /* send counter when it went out */
+  stream_state_t state;
+} stream_entry_t;
+
 /*****************************************************************************/
 /******************************************************************* globals */
 volatile sig_atomic_t run = 1;
 volatile sig_atomic_t stop_wait = 1;
+/* ms the server may spend on a request, 0 => no deadline */
+static uint32_t timeout_ms = 0;
 
 /*****************************************************************************/
 /****************************************************************** functions*/
 
 /** @internal encode user commands
  *
- *  @param cmd pointer to char array
+ *  @param cmd  pointer to char array, tokenized in place
+ *  @param keys receives pointers to the arguments of crack
+ *  @param nkeys receives the number of arguments
  *
  *  @retrun -1 => command not supported
  *           0 => help
  *           1 => cracker
  *           2 => quit client
+ *           3 => batch cracker (keys[0] is the file name)
+ *           4 => server metrics
+ *           5 => string cracker (keys[0] length, keys[1] alphabet)
+ *           6 => file cracker (keys[0] is the file name)
  *
  */
-static int encode_command(char *cmd)
+static int encode_command(char *cmd, char **keys, int *nkeys)
 {
 
   char *pch = NULL;
   int i = 0;
   int ret = -1;
 
-  pch = strtok (cmd," ");
+  *nkeys = 0;
+  pch = strtok (cmd," \r\n");
   while (pch != NULL)  {
     if(i == 0) {
-      if(strncmp(pch, "crack", 5) == 0) {
+      if(strcmp(pch, "crackbatch") == 0) {
+        ret = 3;
+      } else if(strcmp(pch, "crackfile") == 0) {
+        ret = 6;
+      } else if(strcmp(pch, "crackstr") == 0) {
+        ret = 5;
+      } else if(strncmp(pch, "crack", 5) == 0) {
         ret = 1;
       } else if(strncmp(pch, "help", 4) == 0) {
         ret = 0;
       } else if(strncmp(pch, "quit", 4) == 0) {
         ret = 2;
+      } else if(strcmp(pch, "stats") == 0) {
+        ret = 4;
       } else {
         ret = -1;
       }
-    } else if(i == 1) {
-      strcpy(cmd, pch);
+    } else if(((ret == 1 || ret == 5) && *nkeys < MAX_KEYS) ||
+              ((ret == 3 || ret == 6) && *nkeys < 1)) {
+      keys[(*nkeys)++] = pch;
     } else {
       ret = -1;
     }
-    pch = strtok (NULL, " ,.");
+    /* crack keys are split at ',' and '.' too, file names and
+       alphabets only at white space */
+    pch = strtok (NULL, ret == 1 ? " ,.\r\n" : " \r\n");
     i++;
   }
 
+  /* crack needs at least one key, crackbatch and crackfile a file,
+     crackstr a length and an alphabet in front of the keys */
+  if(((ret == 1 || ret == 3 || ret == 6) && *nkeys == 0) ||
+      (ret == 5 && *nkeys < 3)) {
+    ret = -1;
+  }
+
+  return ret;
+}
+
+/** @internal expand an alphabet like "a-z0-9_" into its characters
+ *
+ *  @retrun number of characters, 0 => empty or longer than cap - 1
+ */
+static size_t expand_alphabet(const char *spec, char *out, size_t cap)
+{
+  size_t n = 0;
+  int c, last;
+
+  while(*spec != '\0') {
+    c = (unsigned char)spec[0];
+    last = c;
+    if(spec[1] == '-' && spec[2] != '\0') {
+      last = (unsigned char)spec[2];
+      spec += 2;
+    }
+    spec++;
+    for(; c <= last; c++) {
+      if(n + 1 >= cap) {
+        return 0;
+      }
+      out[n++] = (char)c;
+    }
+  }
+  out[n] = '\0';
+
+  return n;
+}
+
+/** @internal build a CRACK_STRING payload
+ *
+ *  @retrun payload length, 0 => does not fit into cap
+ */
+static size_t string_request(uint8_t *buf, size_t cap, uint32_t length,
+                             const char *alphabet, const char *key)
+{
+  size_t n = strlen(alphabet), k = strlen(key);
+
+  if(8 + n + k > cap) {
+    return 0;
+  }
+  proto_put_u32(buf, length);
+  proto_put_u32(buf + 4, (uint32_t)n);
+  memcpy(buf + 8, alphabet, n);
+  memcpy(buf + 8 + n, key, k);
+
+  return 8 + n + k;
+}
+
+/** @internal send a complete frame, with the deadline of -t
+ *
+ *  @retrun 0 => ok, -1 => error
+ */
+static int send_frame(int fd, uint16_t type, uint32_t id,
+                      const void *payload, uint32_t len)
+{
+  uint8_t hdr_buf[PROTO_HDR_LEN + 4];
+  size_t hdr_len = PROTO_HDR_LEN;
+  proto_hdr_t hdr;
+
+  hdr.len = len;
+  hdr.id = id;
+  hdr.type = type;
+  hdr.flags = 0;
+  if(timeout_ms > 0) {
+    hdr.len += 4;
+    hdr.flags = PROTO_FLAG_DEADLINE;
+    proto_put_u32(hdr_buf + PROTO_HDR_LEN, timeout_ms);
+    hdr_len += 4;
+  }
+  proto_pack_hdr(hdr_buf, &hdr);
+
+  if(send(fd, hdr_buf, hdr_len, MSG_MORE) != (ssize_t)hdr_len) {
+    return -1;
+  }
+  if(len > 0 && send(fd, payload, len, 0) != len) {
+    return -1;
+  }
+
+  return 0;
+}
+
+/** @internal receive exactly len bytes
+ *
+ *  @retrun 0 => ok, -1 => error or connection closed
+ */
+static int recv_all(int fd, void *buf, size_t len)
+{
+  char *p = buf;
+  ssize_t size;
+
+  while(len > 0) {
+    size = recv(fd, p, len, 0);
+    if(size < 0 && errno == EINTR) {
+      continue;
+    }
+    if(size <= 0) {
+      return -1;
+    }
+    p += size;
+    len -= size;
+  }
+
+  return 0;
+}
+
+/** @internal receive one frame, the payload is truncated to cap-1
+ *            bytes and NUL terminated
+ *
+ *  @retrun 0 => ok, -1 => error or connection closed
+ */
+static int recv_frame(int fd, proto_hdr_t *hdr, char *payload,
+                      size_t cap)
+{
+  uint8_t hdr_buf[PROTO_HDR_LEN];
+  char rest[256];
+  size_t keep, skip;
+
+  if(recv_all(fd, hdr_buf, PROTO_HDR_LEN) < 0) {
+    return -1;
+  }
+  proto_unpack_hdr(hdr_buf, hdr);
+
+  keep = hdr->len < cap - 1 ? hdr->len : cap - 1;
+  if(recv_all(fd, payload, keep) < 0) {
+    return -1;
+  }
+  payload[keep] = '\0';
+
+  /* drop what does not fit */
+  for(skip = hdr->len - keep; skip > 0; skip -= keep) {
+    keep = skip < sizeof(rest) ? skip : sizeof(rest);
+    if(recv_all(fd, rest, keep) < 0) {
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+/** @internal append one CRACK frame to buf
+ *
+ *  @retrun 0 => ok, -1 => out of memory
+ */
+static int frame_append(uint8_t **buf, size_t *len, size_t *cap,
+                        uint32_t id, const char *payload)
+{
+  uint8_t *tmp;
+  proto_hdr_t hdr;
+  size_t size = strlen(payload), extra = timeout_ms > 0 ? 4 : 0;
+
+  while(*cap - *len < PROTO_HDR_LEN + extra + size) {
+    *cap = *cap ? *cap * 2 : 65536;
+    if((tmp = realloc(*buf, *cap)) == NULL) {
+      return -1;
+    }
+    *buf = tmp;
+  }
+
+  hdr.len = (uint32_t)(extra + size);
+  hdr.id = id;
+  hdr.type = PROTO_CRACK;
+  hdr.flags = extra ? PROTO_FLAG_DEADLINE : 0;
+  proto_pack_hdr(*buf + *len, &hdr);
+  if(extra) {
+    proto_put_u32(*buf + *len + PROTO_HDR_LEN, timeout_ms);
+  }
+  memcpy(*buf + *len + PROTO_HDR_LEN + extra, payload, size);
+  *len += PROTO_HDR_LEN + extra + size;
+
+  return 0;
+}
+
+/** @internal crack every line of in, write the results to out
+ *
+ *  Up to window lines are buffered, the request id is the line
+ *  number.  Replies arrive in any order and are written in input
+ *  order as "0x%08x<TAB>line".  BUSY replies are sent again and halve
+ *  the number of requests in flight (once per round trip), every
+ *  result raises it by one, so a window larger than the server queue
+ *  does not end in a storm of retries.  Requests go out without
+ *  blocking and replies are read while the rest waits for room in
+ *  the socket, a server that stops reading until its replies are
+ *  taken does not deadlock a large window.
+ *
+ *  @retrun number of lines that failed, -1 => connection lost
+ */
+static long crack_stream(int fd, FILE *in, FILE *out, uint32_t window)
+{
+  struct timespec pause = { 0, 1000000 };
+  struct pollfd pfd = { fd, POLLIN | POLLOUT, 0 };
+  stream_entry_t *win;
+  stream_entry_t *e;
+  uint8_t *obuf = NULL;
+  size_t olen = 0, ooff = 0, ocap = 0, len, cap = 0;
+  uint32_t head = 0, tail = 0, seq, inflight = 0, retry = 0;
+  uint32_t limit = window, sends = 0, cut = 0;
+  char payload[BUF];
+  char *line = NULL;
+  ssize_t size;
+  proto_hdr_t hdr;
+  long failed = 0;
+  int eof = 0, ready;
+
+  if((win = calloc(window, sizeof(*win))) == NULL) {
+    perror("calloc");
+    return -1;
+  }
+
+  while(run && (!eof || head != tail)) {
+    /* BUSY requests first, in input order; nothing of ours in the
+       server queue => give it a moment to drain */
+    if(retry > 0 && inflight < limit) {
+      if(inflight == 0) {
+        nanosleep(&pause, NULL);
+      }
+      for(seq = head; seq != tail && retry > 0 && inflight < limit;
+          seq++) {
+        e = &win[seq % window];
+        if(e->state == STREAM_RETRY) {
+          e->state = STREAM_SENT;
+          e->sent = sends++;
+          if(frame_append(&obuf, &olen, &ocap, seq, e->line) < 0) {
+            goto oom;
+          }
+          inflight++;
+          retry--;
+        }
+      }
+    }
+
+    /* new lines */
+    while(!eof && retry == 0 && inflight < limit && tail - head < window) {
+      if((size = getline(&line, &cap, in)) < 0) {
+        eof = 1;
+        break;
+      }
+      while(size > 0 &&
+            (line[size - 1] == '\n' || line[size - 1] == '\r')) {
+        line[--size] = '\0';
+      }
+      e = &win[tail % window];
+      if((e->line = strdup(line)) == NULL ||
+          frame_append(&obuf, &olen, &ocap, tail, line) < 0) {
+        goto oom;
+      }
+      e->state = STREAM_SENT;
+      e->sent = sends++;
+      inflight++;
+      tail++;
+    }
+
+    /* one send for all new requests, as much as the socket takes */
+    if(ooff < olen) {
+      size = send(fd, obuf + ooff, olen - ooff, MSG_DONTWAIT);
+      if(size < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+         errno != EINTR) {
+        failed = -1;
+        break;
+      }
+      if(size > 0 && (ooff += (size_t)size) == olen) {
+        ooff = olen = 0;
+      }
+    }
+    if(inflight == 0) {
+      continue;
+    }
+
+    /* the rest waits for room or for a reply that makes some */
+    if(olen > 0) {
+      if((ready = poll(&pfd, 1, -1)) < 0 && errno != EINTR) {
+        failed = -1;
+        break;
+      }
+      if(ready <= 0 || !(pfd.revents & (POLLIN | POLLERR | POLLHUP))) {
+        continue;
+      }
+    }
+
+    if(recv_frame(fd, &hdr, payload, sizeof(payload)) < 0) {
+      failed = -1;
+      break;
+    }
+    e = &win[hdr.id % window];
+    if(hdr.id - head >= tail - head || e->state != STREAM_SENT) {
+      /* not from this stream */
+      continue;
+    }
+    inflight--;
+    if(hdr.type == PROTO_RESULT) {
+      e->result = (uint32_t)strtoul(payload, NULL, 16);
+      e->state = STREAM_DONE;
+      if(limit < window) {
+        limit++;
+      }
+    } else if(hdr.type == PROTO_BUSY) {
+      e->state = STREAM_RETRY;
+      retry++;
+      if((int32_t)(e->sent - cut) >= 0) {
+        limit = limit > 1 ? limit / 2 : 1;
+        cut = sends;
+      }
+    } else {
+      fprintf(stderr, "%s: %s\n", e->line,
+              hdr.type == PROTO_TIMEOUT ? "timeout" : payload);
+      e->state = STREAM_ERROR;
+    }
+
+    /* write what is complete, in input order */
+    while(head != tail && win[head % window].state >= STREAM_DONE) {
+      e = &win[head % window];
+      if(e->state == STREAM_DONE) {
+        fprintf(out, "0x%08"PRIx32"\t%s\n", e->result, e->line);
+      } else {
+        failed++;
+      }
+      free(e->line);
+      e->line = NULL;
+      e->state = STREAM_FREE;
+      head++;
+    }
+  }
+  goto out;
+
+oom:
+  perror("malloc");
+  failed = -1;
+
+out:
+  for(len = 0; len < window; len++) {
+    free(win[len].line);
+  }
+  free(win);
+  free(obuf);
+  free(line);
+  fflush(out);
+
+  return failed;
+}
+
+/** @internal ask the server for its metrics and print them
+ *
+ *  @retrun 0 => ok, -1 => connection lost
+ */
+static int print_stats(int fd, uint32_t id)
+{
+  char report[STATS_BUF];
+  proto_hdr_t hdr;
+
+  if(send_frame(fd, PROTO_STATS, id, NULL, 0) < 0) {
+    return -1;
+  }
+  do {
+    if(recv_frame(fd, &hdr, report, sizeof(report)) < 0) {
+      return -1;
+    }
+  } while(hdr.id != id);
+
+  if(hdr.type == PROTO_STATS_RESULT) {
+    printf("%s", report);
+  } else {
+    printf("Error: %s\n", report);
+  }
+
+  return 0;
+}
+
+/** @internal read all lines of a file, without line endings
+ *
+ *  @retrun array of *count allocated lines, NULL on error
+ */
+static char **read_lines(const char *path, size_t *count)
+{
+  FILE *fp;
+  char **lines = NULL, **tmp;
+  char *line = NULL;
+  size_t cap = 0, n = 0, len = 0;
+  ssize_t size;
+  int oom = 0;
+
+  if((fp = fopen(path, "r")) == NULL) {
+    perror(path);
+    return NULL;
+  }
+
+  while((size = getline(&line, &len, fp)) >= 0) {
+    while(size > 0 && (line[size-1] == '\n' || line[size-1] == '\r')) {
+      line[--size] = '\0';
+    }
+    if(n == cap) {
+      cap = cap ? 2 * cap : 1024;
+      if((tmp = realloc(lines, cap * sizeof(char *))) == NULL) {
+        oom = 1;
+        break;
+      }
+      lines = tmp;
+    }
+    if((lines[n] = strdup(line)) == NULL) {
+      oom = 1;
+      break;
+    }
+    n++;
+  }
+  free(line);
+  fclose(fp);
+
+  if(!oom && lines == NULL && (lines = malloc(sizeof(char *))) == NULL) {
+    oom = 1;
+  }
+  if(oom) {
+    perror("malloc");
+    while(n > 0) {
+      free(lines[--n]);
+    }
+    free(lines);
+    return NULL;
+  }
+  *count = n;
+
+  return lines;
+}
+
+/** @internal write a CRACK_BATCH frame of lines [from, to) to buf,
+ *            with the deadline of -t
+ *
+ *  @retrun length of the frame
+ */
+static size_t batch_frame(uint8_t *buf, char **lines, size_t from,
+                          size_t to, uint32_t id)
+{
+  size_t extra = timeout_ms > 0 ? 4 : 0, off, item, i;
+  proto_hdr_t hdr;
+
+  off = PROTO_HDR_LEN + extra + 4;
+  for(i = from; i < to; i++) {
+    item = strlen(lines[i]);
+    proto_put_u32(buf + off, (uint32_t)item);
+    memcpy(buf + off + 4, lines[i], item);
+    off += 4 + item;
+  }
+  proto_put_u32(buf + PROTO_HDR_LEN + extra, (uint32_t)(to - from));
+
+  hdr.len = (uint32_t)(off - PROTO_HDR_LEN);
+  hdr.id = id;
+  hdr.type = PROTO_CRACK_BATCH;
+  hdr.flags = extra ? PROTO_FLAG_DEADLINE : 0;
+  proto_pack_hdr(buf, &hdr);
+  if(extra) {
+    proto_put_u32(buf + PROTO_HDR_LEN, timeout_ms);
+  }
+
+  return off;
+}
+
+/** @internal crack every line of a file with CRACK_BATCH requests
+ *
+ *  The lines are packed into as few batches as the frame size
+ *  allows.  Batches go out without blocking and replies are read in
+ *  the same loop, so a server that stops reading until its replies
+ *  are taken does not deadlock a large file.  BUSY batches are sent
+ *  again and halve the number of batches in flight, every result
+ *  raises it by one, like the stream mode.
+ *
+ *  @retrun 0 => ok, -1 => connection lost
+ */
+static int crack_batch_file(int fd, const char *path, uint32_t *next_id)
+{
+  struct timespec pause = { 0, 1000000 };
+  struct pollfd pfd = { fd, POLLIN, 0 };
+  char **lines;
+  size_t count, i, off, cap, nbatch = 0, pending;
+  size_t olen = 0, ooff = 0, next = 0, inflight = 0, retry = 0, limit;
+  size_t *first = NULL;
+  uint8_t *obuf = NULL, *result = NULL;
+  uint32_t *answer = NULL;
+  stream_state_t *state = NULL;
+  char text[BUF];
+  proto_hdr_t hdr;
+  ssize_t size;
+  int ret = 0, ready, more;
+
+  if((lines = read_lines(path, &count)) == NULL) {
+    return 0;
+  }
+  if(count == 0) {
+    free(lines);
+    return 0;
+  }
+
+  obuf = malloc(PROTO_HDR_LEN + PROTO_MAX_PAYLOAD);
+  answer = calloc(count, sizeof(uint32_t));
+  first = malloc((count + 1) * sizeof(size_t));
+  result = malloc(4 + 4 * PROTO_MAX_BATCH + 1);
+  /* at most one batch per line */
+  state = calloc(count, sizeof(*state));
+  if(obuf == NULL || answer == NULL || first == NULL ||
+      result == NULL || state == NULL) {
+    perror("malloc");
+    goto out;
+  }
+
+  /* cut the lines into batches, the deadline takes 4 payload bytes */
+  cap = PROTO_MAX_PAYLOAD - (timeout_ms > 0 ? 4 : 0);
+  for(i = 0; i < count; ) {
+    first[nbatch] = i;
+    off = 4;
+    while(i < count && i - first[nbatch] < PROTO_MAX_BATCH &&
+          off + 4 + strlen(lines[i]) <= cap) {
+      off += 4 + strlen(lines[i]);
+      i++;
+    }
+    if(i == first[nbatch]) {
+      fprintf(stderr, "line %zu too long\n", i + 1);
+      goto out;
+    }
+    nbatch++;
+  }
+  first[nbatch] = count;
+
+  /* send and collect in one loop, one reply per batch in any order */
+  limit = nbatch;
+  for(pending = nbatch; pending > 0 && run; ) {
+    /* next frame once the last one is out: BUSY batches first, in
+       order; nothing of ours in the server queue => give it a moment
+       to drain */
+    if(ooff == olen) {
+      ooff = olen = 0;
+      i = nbatch;
+      if(retry > 0 && inflight < limit) {
+        if(inflight == 0) {
+          nanosleep(&pause, NULL);
+        }
+        for(i = 0; state[i] != STREAM_RETRY; i++) {
+        }
+        retry--;
+      } else if(retry == 0 && next < nbatch) {
+        i = next++;
+      }
+      if(i < nbatch) {
+        olen = batch_frame(obuf, lines, first[i], first[i + 1],
+                           *next_id + (uint32_t)i);
+        state[i] = STREAM_SENT;
+        inflight++;
+      }
+    }
+
+    /* as much as the socket takes */
+    if(ooff < olen) {
+      size = send(fd, obuf + ooff, olen - ooff, MSG_DONTWAIT);
+      if(size < 0 && errno != EAGAIN && errno != EWOULDBLOCK &&
+         errno != EINTR) {
+        ret = -1;
+        goto out;
+      }
+      if(size > 0) {
+        ooff += (size_t)size;
+      }
+    }
+    more = ooff < olen || (retry == 0 && next < nbatch) ||
+           (retry > 0 && inflight < limit);
+    if(inflight == 0) {
+      continue;
+    }
+
+    /* a reply, or room for the rest */
+    pfd.events = POLLIN | (more ? POLLOUT : 0);
+    if((ready = poll(&pfd, 1, -1)) < 0 && errno != EINTR) {
+      ret = -1;
+      goto out;
+    }
+    if(ready <= 0 || !(pfd.revents & (POLLIN | POLLERR | POLLHUP))) {
+      continue;
+    }
+    if(recv_frame(fd, &hdr, (char *)result, 4 + 4 * PROTO_MAX_BATCH + 1)
+        < 0) {
+      ret = -1;
+      goto out;
+    }
+    i = hdr.id - *next_id;
+    if(i >= nbatch || state[i] != STREAM_SENT) {
+      continue;
+    }
+    inflight--;
+    if(hdr.type == PROTO_BUSY) {
+      state[i] = STREAM_RETRY;
+      retry++;
+      limit = limit > 1 ? limit / 2 : 1;
+      continue;
+    }
+    pending--;
+    if(hdr.type != PROTO_BATCH_RESULT ||
+        proto_get_u32(result) != first[i + 1] - first[i]) {
+      fprintf(stderr, "batch %zu failed: %s\n", i,
+              hdr.type == PROTO_TIMEOUT ? "timeout" : (char *)result);
+      state[i] = STREAM_ERROR;
+      continue;
+    }
+    for(off = first[i]; off < first[i + 1]; off++) {
+      answer[off] = proto_get_u32(result + 4 + 4 * (off - first[i]));
+    }
+    state[i] = STREAM_DONE;
+    if(limit < nbatch) {
+      limit++;
+    }
+  }
+
+  for(i = 0; i < nbatch; i++) {
+    for(off = first[i]; off < first[i + 1] && state[i] == STREAM_DONE;
+        off++) {
+      snprintf(text, sizeof(text), "0x%08x", answer[off]);
+      printf("%s: Hash code: %s\n", lines[off], text);
+    }
+  }
+
+out:
+  *next_id += nbatch;
+  for(i = 0; i < count; i++) {
+    free(lines[i]);
+  }
+  free(lines);
+  free(obuf);
+  free(answer);
+  free(first);
+  free(result);
+  free(state);
+
   return ret;
 }
 
+/** @internal crack the content of a file of any size
+ *
+ *  The file goes out as the body of one CRACK_STREAM, straight from
+ *  the page cache with sendfile(), the server hashes it on the fly.
+ *
+ *  @retrun 0 => ok, -1 => connection lost
+ */
+static int crack_file(int fd, const char *path, uint32_t id)
+{
+  struct timespec t0, t1;
+  struct stat st;
+  uint8_t payload[8];
+  char result[BUF];
+  proto_hdr_t hdr;
+  off_t off = 0;
+  ssize_t size;
+  double secs;
+  int in;
+
+  if((in = open(path, O_RDONLY)) < 0 || fstat(in, &st) < 0) {
+    perror(path);
+    if(in >= 0) {
+      close(in);
+    }
+    return 0;
+  }
+  if(!S_ISREG(st.st_mode)) {
+    fprintf(stderr, "%s: not a regular file\n", path);
+    close(in);
+    return 0;
+  }
+
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  proto_put_u32(payload, (uint32_t)((uint64_t)st.st_size >> 32));
+  proto_put_u32(payload + 4, (uint32_t)st.st_size);
+  if(send_frame(fd, PROTO_CRACK_STREAM, id, payload, sizeof(payload)) < 0) {
+    close(in);
+    return -1;
+  }
+  while(off < st.st_size) {
+    size = sendfile(fd, in, &off, (size_t)(st.st_size - off));
+    if(size < 0 && errno == EINTR) {
+      continue;
+    }
+    if(size <= 0) {
+      close(in);
+      return -1;
+    }
+  }
+  close(in);
+
+  do {
+    if(recv_frame(fd, &hdr, result, sizeof(result)) < 0) {
+      return -1;
+    }
+  } while(hdr.id != id);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  secs = t1.tv_sec - t0.tv_sec + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+  if(hdr.type == PROTO_RESULT) {
+    printf("\r%s: Hash code: %s (%.1f MB in %.2f s)\n", path, result,
+           st.st_size / 1e6, secs);
+  } else if(hdr.type == PROTO_BUSY) {
+    printf("\r%s: Server busy, try again later\n", path);
+  } else if(hdr.type == PROTO_TIMEOUT) {
+    printf("\r%s: Timeout, no answer within %"PRIu32" ms\n", path,
+           timeout_ms);
+  } else {
+    printf("\r%s: Error: %s\n", path, result);
+  }
+
+  return 0;
+}
+
 /** @brief thread to signal user that something is calculated!!
  *
  */
@@ -131,7 +894,13 @@ static void print_usage(void)
 
   printf("\n  Hash cracker client 1.0\n  Maintained by: Fränz Ney\n\n");
   printf("\nUsage:\n------\n");
-  printf("          hash_client [-i IP] [-p port] [-h]\n\n");
+  printf("          hash_client [-i IP] [-p port] [-t timeout ms] [-h]\n");
+  printf("          hash_client [-i IP] [-p port] [-t timeout ms]"
+         " -f input|- [-o output]\n"
+         "                      [-w window]\n");
+  printf("          hash_client -b [-i IP] [-p port] [-c connections]"
+         " [-d seconds]\n"
+         "                      [-r rate] [-w depth] [-f corpus]\n\n");
 }
 
 /** @brief main function for client application
@@ -142,18 +911,35 @@ int main (int argc, char **argv)
   int create_socket;
   char *buffer = malloc (BUF);
   struct sockaddr_in srv;
-  int size;
   int option = 0;
   int iflag = 0, pflag = 0;
   int ret;
+  int i, nkeys, pending, lost = 0;
+  char *keys[MAX_KEYS];
+  char *reply[MAX_KEYS];
+  char payload[BUF];
+  char alphabet[257];
+  uint8_t request[BUF];
+  size_t request_len;
+  uint32_t length = 0;
+  uint16_t reply_type[MAX_KEYS];
+  uint32_t next_id = 0;
+  proto_hdr_t hdr;
   pthread_t thread_wait;
+  int bflag = 0;
+  char *corpus = NULL, *output = NULL;
+  long window = 0, failed;
+  FILE *in = stdin, *out = stdout;
+  load_opts_t load = { DEFAULT_LOAD_CONNS, DEFAULT_LOAD_SECS, 0, 1,
+                       NULL, 0
+                     };
 
   /* fill srv with null */
   memset(&srv, 0, sizeof(struct sockaddr_in));
 
 
   /* decode arguments */
-  while ((option = getopt(argc, argv,"i:p:h")) != -1) {
+  while ((option = getopt(argc, argv,"i:p:bc:d:r:w:f:o:t:h")) != -1) {
     switch (option) {
     case 'i' :
       if(inet_pton(AF_INET, optarg, &srv.sin_addr)) {
@@ -175,6 +961,30 @@ int main (int argc, char **argv)
       srv.sin_port = htons(atoi(optarg));
       pflag = 1;
       break;
+    case 'b':
+      bflag = 1;
+      break;
+    case 'c':
+      load.conns = atoi(optarg);
+      break;
+    case 'd':
+      load.duration = atof(optarg);
+      break;
+    case 'r':
+      load.rate = atof(optarg);
+      break;
+    case 'w':
+      window = atol(optarg);
+      break;
+    case 'f':
+      corpus = optarg;
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 't':
+      timeout_ms = (uint32_t)strtoul(optarg, NULL, 10);
+      break;
     case 'h' :
       print_usage();
       exit(EXIT_FAILURE);
@@ -198,6 +1008,29 @@ int main (int argc, char **argv)
     srv.sin_port = htons(DEFAULT_PORT_NBR);
   }
 
+  /* benchmark mode, no prompt */
+  if(bflag) {
+    load.depth = window > 0 ? (int)window : 1;
+    if(load.conns < 1 || load.duration <= 0 || load.rate < 0) {
+      errno = EINVAL;
+      perror("Invalid load settings");
+      exit(EXIT_FAILURE);
+    }
+    if(corpus != NULL &&
+        ((load.corpus = read_lines(corpus, &load.corpus_len)) == NULL ||
+         load.corpus_len == 0)) {
+      printf("*** Empty corpus %s ***\n", corpus);
+      exit(EXIT_FAILURE);
+    }
+    ret = load_gen_run(&srv, &load, &run);
+    for(i = 0; i < (int)load.corpus_len; i++) {
+      free(load.corpus[i]);
+    }
+    free(load.corpus);
+    free(buffer);
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
   /* create a master socket */
   if((create_socket = socket(srv.sin_family, SOCK_STREAM , 0)) == -1) {
     perror("Error to create socket");
@@ -211,15 +1044,44 @@ int main (int argc, char **argv)
     exit(EXIT_FAILURE);
   }
 
-  /* wait for ACK signal from server */
-  while(1) {
-    size = recv(create_socket, buffer, BUF-1, 0);
-    if( size > 0) {
-      buffer[size] = '\0';
-      if(strncmp(buffer, "ACK", 3) == 0) {
-        break;
-      }
+  /* wait for ACK signal from server, frames follow right after it */
+  if(recv_all(create_socket, buffer, strlen("ACK\r\n")) < 0 ||
+      strncmp(buffer, "ACK", 3) != 0) {
+    close (create_socket);
+    printf("*** No ACK from server ***\n");
+    exit(EXIT_FAILURE);
+  }
+
+  /* stream mode, no prompt, stdout may carry the results */
+  if(corpus != NULL || output != NULL) {
+    if(window <= 0 || window > MAX_WINDOW) {
+      window = window <= 0 ? DEFAULT_WINDOW : MAX_WINDOW;
+    }
+    if(corpus != NULL && strcmp(corpus, "-") != 0 &&
+        (in = fopen(corpus, "r")) == NULL) {
+      perror(corpus);
+      exit(EXIT_FAILURE);
+    }
+    if(output != NULL && strcmp(output, "-") != 0 &&
+        (out = fopen(output, "w")) == NULL) {
+      perror(output);
+      exit(EXIT_FAILURE);
+    }
+    failed = crack_stream(create_socket, in, out, (uint32_t)window);
+    if(failed < 0) {
+      fprintf(stderr, "*** Sorry lost connection to server ***\n");
+    } else if(failed > 0) {
+      fprintf(stderr, "*** %ld lines failed ***\n", failed);
+    }
+    if(in != stdin) {
+      fclose(in);
     }
+    if(out != stdout) {
+      fclose(out);
+    }
+    close(create_socket);
+    free(buffer);
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
   }
 
   /* Succesfully connect with server */
@@ -230,28 +1092,99 @@ int main (int argc, char **argv)
   do {
     /* enter new data */
     printf(ANSI_COLOR_GREEN     "hc >> "     ANSI_COLOR_RESET );
-    fgets (buffer, BUF, stdin);
-    ret = encode_command(buffer);
+    if(fgets (buffer, BUF, stdin) == NULL) {
+      break;
+    }
+    ret = encode_command(buffer, keys, &nkeys);
     if(ret == 0) {
       /* print help */
       printf("Available commands:\n");
-      printf("  crack key       Calculate hash crack\n");
+      printf("  crack key ...   Calculate hash crack (one or more keys)\n");
+      printf("  crackbatch file Calculate hash crack for every line\n");
+      printf("  crackfile file  Calculate hash crack of the file content\n");
+      printf("  crackstr length alphabet key ...\n"
+             "                  Collision of length characters from"
+             " alphabet (ex. a-z0-9)\n");
+      printf("  stats           Display server metrics\n");
       printf("  help            Display this help text\n");
       printf("  quit            Quit hash cracker\n");
       continue;
     } else if(ret == 1) {
       /* crack function */
+    } else if(ret == 5) {
+      /* crack function, printable collision */
+      length = (uint32_t)atoi(keys[0]);
+      if(length == 0 || expand_alphabet(keys[1], alphabet,
+                                        sizeof(alphabet)) == 0) {
+        printf("Invalid length or alphabet\n");
+        continue;
+      }
+      memmove(keys, keys + 2, (nkeys - 2) * sizeof(*keys));
+      nkeys -= 2;
     } else if(ret == 2) {
       /* quit client */
+      break;
+    } else if(ret == 4) {
+      /* server metrics */
+      if(print_stats(create_socket, next_id++) < 0) {
+        printf("\r*** Sorry lost connection to server ***\n");
+        printf("*** client shutdown!! try later again ***\n\n");
+        break;
+      }
+      continue;
+    } else if(ret == 6) {
+      /* crack function, file content of any size */
+      stop_wait = 1;
+      if((pthread_create(&thread_wait, NULL, wait_signal, NULL)) != 0) {
+        perror("Error to create wait thread");
+        exit(EXIT_FAILURE);
+      }
+      lost = crack_file(create_socket, keys[0], next_id++) < 0;
+      stop_wait = 0;
+      pthread_join(thread_wait, NULL);
+      if(lost) {
+        printf("\r*** Sorry lost connection to server ***\n");
+        printf("*** client shutdown!! try later again ***\n\n");
+        break;
+      }
+      continue;
+    } else if(ret == 3) {
+      /* batch crack function */
+      stop_wait = 1;
+      if((pthread_create(&thread_wait, NULL, wait_signal, NULL)) != 0) {
+        perror("Error to create wait thread");
+        exit(EXIT_FAILURE);
+      }
+      lost = crack_batch_file(create_socket, keys[0], &next_id) < 0;
+      stop_wait = 0;
+      pthread_join(thread_wait, NULL);
+      if(lost) {
+        printf("\r*** Sorry lost connection to server ***\n");
+        printf("*** client shutdown!! try later again ***\n\n");
+        break;
+      }
       continue;
     } else {
       /* error */
       continue;
     }
 
-    if(send(create_socket, buffer, strlen (buffer), 0) != strlen(buffer)) {
-      perror("send");
-      exit(EXIT_FAILURE);
+    /* pipeline all keys, the request id is the index + first id */
+    for(i = 0; i < nkeys; i++) {
+      if(ret == 5) {
+        request_len = string_request(request, sizeof(request), length,
+                                     alphabet, keys[i]);
+        if(send_frame(create_socket, PROTO_CRACK_STRING, next_id + i,
+                      request, request_len) < 0) {
+          perror("send");
+          exit(EXIT_FAILURE);
+        }
+      } else if(send_frame(create_socket, PROTO_CRACK, next_id + i,
+                           keys[i], strlen(keys[i])) < 0) {
+        perror("send");
+        exit(EXIT_FAILURE);
+      }
+      reply[i] = NULL;
     }
 
     /* start signal wait thread */
@@ -261,22 +1194,51 @@ int main (int argc, char **argv)
       exit(EXIT_FAILURE);
     }
 
-    /* wait for reply */
-    size = recv(create_socket, buffer, BUF-1, 0);
+    /* wait for all replies, they may arrive in any order */
+    for(pending = nkeys; pending > 0 && !lost; ) {
+      if(recv_frame(create_socket, &hdr, payload, sizeof(payload)) < 0) {
+        lost = 1;
+        break;
+      }
+      i = (int)(hdr.id - next_id);
+      if(i < 0 || i >= nkeys || reply[i] != NULL) {
+        continue;
+      }
+      reply[i] = strdup(payload);
+      reply_type[i] = hdr.type;
+      pending--;
+    }
+    next_id += nkeys;
+
+    /* stop thread */
+    stop_wait = 0;
+    pthread_join(thread_wait, NULL);
+
     /* check if server is diconnected */
-    if(size == 0) {
+    if(lost) {
       printf("\r*** Sorry lost connection to server ***\n");
       printf("*** client shutdown!! try later again ***\n\n");
       break;
     }
-    /* stop thread */
-    stop_wait = 0;
-    pthread_join(thread_wait, NULL);
-    if( size > 0) {
-      buffer[size] = '\0';
+
+    for(i = 0; i < nkeys; i++) {
+      if(nkeys > 1) {
+        printf("%s: ", keys[i]);
+      }
+      if(reply_type[i] == PROTO_RESULT) {
+        printf ("Hash code: %s\n", reply[i]);
+      } else if(reply_type[i] == PROTO_STRING_RESULT) {
+        printf ("Collision: %s\n", reply[i]);
+      } else if(reply_type[i] == PROTO_BUSY) {
+        printf ("Server busy, try again later\n");
+      } else if(reply_type[i] == PROTO_TIMEOUT) {
+        printf ("Timeout, no answer within %"PRIu32" ms\n", timeout_ms);
+      } else {
+        printf ("Error: %s\n", reply[i]);
+      }
+      free(reply[i]);
     }
-    printf ("Hash code: %s\n", buffer);
-  } while ((strcmp(buffer, "quit\n") != 0) && (run));
+  } while (run);
 
   /* close connection */
   close (create_socket);
@@ -0,0 +1,935 @@
+/**
+ * @file hash_crack.c
+ * @date 17 Oct 2026
+ * @brief Collision search engine shared by the hash cracker tools
+ *
+ *        crc32 over a fixed 4 byte input is a bijection on 32 bit
+ *        values, so every target crc has exactly one colliding
+ *        candidate.  crack_solve() computes it directly by walking the
+ *        crc register backwards, crack_bruteforce() is the original
+ *        linear scan and serves as reference and fallback.
+ *
+ *        The brute force runs one of two scan kernels: the byte-wise
+ *        reference calling crc32() per candidate, or a kernel built
+ *        on the fixed length formula
+ *
+ *          crc(i) = crc(0) ^ lin[3][i>>24] ^ lin[2][(i>>16)&0xFF]
+ *                          ^ lin[1][(i>>8)&0xFF] ^ lin[0][i&0xFF]
+ *
+ *        (crc32 is affine over GF(2)) which checks a block of 256
+ *        candidates against one broadcast value in AVX2/AVX-512 lanes.
+ *        The same linearity drives the Gray code kernel: walking the
+ *        candidates in Gray code order flips one bit per step, so
+ *        the crc changes by one precomputed delta per step.  A batch
+ *        of targets is scanned in one pass, every candidate is looked
+ *        up in a small hash set of the targets.
+ *
+ *        Collisions made of a given alphabet and length are found by
+ *        meet-in-the-middle: the table holds the crc register after
+ *        every prefix of the first half, the search walks the
+ *        suffixes of the second half backwards from the target
+ *        register (crc32_rewind() one byte at a time) and looks the
+ *        register in front of the suffix up in the table.  That is
+ *        about alphabet^(length/2) steps instead of alphabet^length.
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#define _POSIX_C_SOURCE     200809L
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#include "crc32.h"
+#include "hash_crack.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRACK_HAVE_SIMD 1
+#include <immintrin.h>
+#endif
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define CRACK_SPACE         (UINT64_C(1) << 32)
+#define CRACK_CHUNK         (UINT64_C(1) << 20)
+#define CRACK_BLOCK         256
+#define CRACK_GRAY_BLOCK    (UINT64_C(1) << 16)
+#define CRACK_MITM_MIN_SLOTS  16
+#define CRACK_MITM_MAX_SLOTS  (UINT64_C(1) << 31)
+#define CRACK_MITM_EMPTY      UINT32_MAX
+#define CRACK_MITM_POLL       4096
+#define CRACK_TARGET_EMPTY    UINT64_MAX        /* free slot */
+#define CRACK_TARGET_OPEN     (UINT64_MAX - 1)  /* no candidate yet */
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+
+/* scan candidates [lo, hi) and return the first match */
+typedef int (*crack_scan_fn_t)(uint32_t crc, uint64_t lo, uint64_t hi,
+                               uint32_t *result);
+
+/* the distinct crcs of a batch scan and the candidate found for each,
+   open addressing with linear probing; remaining counts the crcs
+   without a candidate yet */
+typedef struct crack_targets_s {
+  uint32_t *crc;
+  uint64_t *found;
+  uint32_t mask;
+  long remaining;
+} crack_targets_t;
+
+/* register after a prefix and the number of the first prefix that
+   leads there, open addressing with linear probing */
+typedef struct crack_mitm_slot_s {
+  uint32_t state;
+  uint32_t prefix;
+} crack_mitm_slot_t;
+
+struct crack_mitm_s {
+  uint8_t alphabet[256];
+  unsigned radix;
+  size_t length;
+  size_t prefix_len;
+  uint64_t prefixes;
+  uint64_t mask;
+  crack_mitm_slot_t *slot;
+};
+
+/*****************************************************************************/
+/******************************************************************* globals */
+
+/* linear part of the fixed length formula, lin[k][n] = crc(n << 8k)
+   ^ crc(0), lin[0] is aligned for the vector loads */
+static uint32_t crack_lin[4][256] __attribute__((aligned(64)));
+static uint32_t crack_crc0;
+/* one byte of crc32_update()/crc32_rewind() */
+static uint32_t crack_tab[256];
+static uint8_t crack_tab_inv[256];
+static pthread_once_t crack_once = PTHREAD_ONCE_INIT;
+static crack_scan_fn_t crack_scan_simd_impl;
+static const char *crack_simd_impl_name;
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+void crack_candidate_bytes(uint32_t i, uint8_t out[4])
+{
+  out[0] = (uint8_t)(i >> 24);
+  out[1] = (uint8_t)(i >> 16);
+  out[2] = (uint8_t)(i >> 8);
+  out[3] = (uint8_t)i;
+}
+
+int crack_solve(uint32_t crc, uint32_t *result)
+{
+  static const uint8_t zero[4] = { 0, 0, 0, 0 };
+  uint32_t w;
+
+  /* Feeding the word W from state s is the same as feeding four zero
+     bytes from state s ^ W, so rewinding four zero bytes from the final
+     register gives CRC32_INIT ^ W.  W holds the first input byte in its
+     low byte, the candidate holds it in its high byte. */
+  w = crc32_rewind(crc32_final(crc), zero, sizeof(zero)) ^ CRC32_INIT;
+
+  *result = (w >> 24) | ((w >> 8) & 0xFF00) |
+            ((w << 8) & 0xFF0000) | (w << 24);
+
+  return 0;
+}
+
+/** @internal scan candidates [lo, hi) for the first match
+ *
+ */
+static int crack_scan_bytewise(uint32_t crc, uint64_t lo, uint64_t hi,
+                               uint32_t *result)
+{
+  uint8_t in[4];
+  uint64_t i;
+
+  for (i = lo; i < hi; i++) {
+    crack_candidate_bytes((uint32_t)i, in);
+    if (crc32(in, sizeof(in)) == crc) {
+      *result = (uint32_t)i;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+/** @internal crc of the block base, i.e. with the low byte of i zero
+ *
+ */
+static inline uint32_t crack_block_crc(uint32_t i)
+{
+  return crack_crc0 ^ crack_lin[3][i >> 24] ^
+         crack_lin[2][(i >> 16) & 0xFF] ^ crack_lin[1][(i >> 8) & 0xFF];
+}
+
+/** @internal fixed length formula, one candidate at a time
+ *
+ */
+static int crack_scan_scalar(uint32_t crc, uint64_t lo, uint64_t hi,
+                             uint32_t *result)
+{
+  uint64_t i;
+
+  for (i = lo; i < hi; i++) {
+    if ((crack_block_crc((uint32_t)i) ^
+         crack_lin[0][i & 0xFF]) == crc) {
+      *result = (uint32_t)i;
+      return 0;
+    }
+  }
+
+  return -1;
+}
+
+/** @internal Gray code order, one xor per candidate
+ *
+ */
+static int crack_scan_gray(uint32_t crc, uint64_t lo, uint64_t hi,
+                           uint32_t *result)
+{
+  uint32_t delta[32];
+  uint64_t base, head, best;
+  uint32_t cur, k;
+  int b;
+
+  /* crc(i ^ (1 << b)) == crc(i) ^ delta[b] */
+  for (b = 0; b < 32; b++) {
+    delta[b] = crack_lin[b / 8][1u << (b % 8)];
+  }
+
+  /* unaligned head and tail go through the scalar formula */
+  head = (lo + CRACK_GRAY_BLOCK - 1) & ~(CRACK_GRAY_BLOCK - 1);
+  if (head > hi) {
+    head = hi;
+  }
+  if (crack_scan_scalar(crc, lo, head, result) == 0) {
+    return 0;
+  }
+
+  for (base = head; base + CRACK_GRAY_BLOCK <= hi;
+       base += CRACK_GRAY_BLOCK) {
+    /* step k visits base ^ k ^ (k >> 1), which differs from the
+       previous candidate in bit ctz(k); the block is visited out of
+       order, so it is finished to return its lowest match */
+    cur = crack_block_crc((uint32_t)base) ^ crack_lin[0][0];
+    best = UINT64_MAX;
+    if (cur == crc) {
+      best = base;
+    }
+    for (k = 1; k < CRACK_GRAY_BLOCK; k++) {
+      cur ^= delta[__builtin_ctz(k)];
+      if (cur == crc && (base ^ k ^ (k >> 1)) < best) {
+        best = base ^ k ^ (k >> 1);
+      }
+    }
+    if (best != UINT64_MAX) {
+      *result = (uint32_t)best;
+      return 0;
+    }
+  }
+
+  return crack_scan_scalar(crc, base, hi, result);
+}
+
+#ifdef CRACK_HAVE_SIMD
+/** @internal 8 candidates per compare
+ *
+ */
+__attribute__((target("avx2")))
+static int crack_scan_avx2(uint32_t crc, uint64_t lo, uint64_t hi,
+                           uint32_t *result)
+{
+  const __m256i *lin = (const __m256i *)crack_lin[0];
+  uint64_t base, head;
+  __m256i want, hit;
+  uint32_t mask;
+  int k;
+
+  /* unaligned head and tail go through the scalar formula */
+  head = (lo + CRACK_BLOCK - 1) & ~(uint64_t)(CRACK_BLOCK - 1);
+  if (head > hi) {
+    head = hi;
+  }
+  if (crack_scan_scalar(crc, lo, head, result) == 0) {
+    return 0;
+  }
+
+  for (base = head; base + CRACK_BLOCK <= hi; base += CRACK_BLOCK) {
+    want = _mm256_set1_epi32((int)(crack_block_crc((uint32_t)base) ^ crc));
+    hit = _mm256_setzero_si256();
+    for (k = 0; k < CRACK_BLOCK / 8; k++) {
+      hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(lin[k], want));
+    }
+    if (!_mm256_testz_si256(hit, hit)) {
+      /* rare, locate the lowest lane */
+      for (k = 0; k < CRACK_BLOCK / 8; k++) {
+        mask = (uint32_t)_mm256_movemask_ps(
+                 _mm256_castsi256_ps(_mm256_cmpeq_epi32(lin[k], want)));
+        if (mask) {
+          *result = (uint32_t)(base + k * 8 + __builtin_ctz(mask));
+          return 0;
+        }
+      }
+    }
+  }
+
+  return crack_scan_scalar(crc, base, hi, result);
+}
+
+/** @internal 16 candidates per compare
+ *
+ */
+__attribute__((target("avx512f")))
+static int crack_scan_avx512(uint32_t crc, uint64_t lo, uint64_t hi,
+                             uint32_t *result)
+{
+  const __m512i *lin = (const __m512i *)crack_lin[0];
+  uint64_t base, head;
+  __m512i want;
+  __mmask16 hit;
+  int k;
+
+  /* unaligned head and tail go through the scalar formula */
+  head = (lo + CRACK_BLOCK - 1) & ~(uint64_t)(CRACK_BLOCK - 1);
+  if (head > hi) {
+    head = hi;
+  }
+  if (crack_scan_scalar(crc, lo, head, result) == 0) {
+    return 0;
+  }
+
+  for (base = head; base + CRACK_BLOCK <= hi; base += CRACK_BLOCK) {
+    want = _mm512_set1_epi32((int)(crack_block_crc((uint32_t)base) ^ crc));
+    for (k = 0; k < CRACK_BLOCK / 16; k++) {
+      hit = _mm512_cmpeq_epi32_mask(lin[k], want);
+      if (hit) {
+        *result = (uint32_t)(base + k * 16 + __builtin_ctz(hit));
+        return 0;
+      }
+    }
+  }
+
+  return crack_scan_scalar(crc, base, hi, result);
+}
+#endif
+
+/** @internal build the formula tables and pick the vector kernel
+ *
+ */
+static void crack_init(void)
+{
+  uint8_t in[4];
+  int k, n;
+
+  for (n = 0; n < 256; n++) {
+    in[0] = (uint8_t)n;
+    crack_tab[n] = crc32_update(0, in, 1);
+    crack_tab_inv[crack_tab[n] >> 24] = (uint8_t)n;
+  }
+
+  crack_candidate_bytes(0, in);
+  crack_crc0 = crc32(in, sizeof(in));
+  for (k = 0; k < 4; k++) {
+    for (n = 0; n < 256; n++) {
+      crack_candidate_bytes((uint32_t)n << (8 * k), in);
+      crack_lin[k][n] = crc32(in, sizeof(in)) ^ crack_crc0;
+    }
+  }
+
+  crack_scan_simd_impl = crack_scan_scalar;
+  crack_simd_impl_name = "scalar";
+#ifdef CRACK_HAVE_SIMD
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    crack_scan_simd_impl = crack_scan_avx512;
+    crack_simd_impl_name = "avx512";
+  } else if (__builtin_cpu_supports("avx2")) {
+    crack_scan_simd_impl = crack_scan_avx2;
+    crack_simd_impl_name = "avx2";
+  }
+#endif
+}
+
+const char *crack_simd_name(void)
+{
+  pthread_once(&crack_once, crack_init);
+
+  return crack_simd_impl_name;
+}
+
+/** @internal has the deadline of opts passed
+ *
+ */
+static int crack_expired(const crack_opts_t *opts)
+{
+  struct timespec ts;
+
+  if (opts->deadline == 0) {
+    return 0;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec >=
+         opts->deadline;
+}
+
+/** @internal lower *best to value
+ *
+ */
+static void crack_atomic_min(uint64_t *best, uint64_t value)
+{
+  uint64_t cur = __atomic_load_n(best, __ATOMIC_RELAXED);
+
+  while (value < cur &&
+         !__atomic_compare_exchange_n(best, &cur, value, 0,
+                                      __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+  }
+}
+
+int crack_bruteforce_range(uint32_t crc, uint64_t lo, uint64_t hi,
+                           const crack_opts_t *opts, uint32_t *result,
+                           volatile sig_atomic_t *run)
+{
+  crack_scan_fn_t scan = crack_scan_bytewise;
+  int threads = opts->threads;
+  uint64_t next = lo;
+  uint64_t best = UINT64_MAX;
+
+  if (hi > CRACK_SPACE) {
+    hi = CRACK_SPACE;
+  }
+
+  /* the solver falls back to the fastest kernel */
+  if (opts->engine != CRACK_ENGINE_BRUTE) {
+    pthread_once(&crack_once, crack_init);
+    scan = (opts->engine == CRACK_ENGINE_GRAY) ? crack_scan_gray :
+           crack_scan_simd_impl;
+  }
+
+#ifdef _OPENMP
+  if (threads <= 0) {
+    threads = omp_get_num_procs();
+  }
+#else
+  (void)threads;
+#endif
+
+  /* Every thread claims the next chunk until a match is known below
+     the chunk start, chunks are claimed in ascending order so all
+     chunks in front of the lowest match are scanned completely. */
+  #pragma omp parallel num_threads(threads)
+  {
+    uint64_t from;
+    uint32_t hit;
+
+    while (1) {
+      from = __atomic_fetch_add(&next, CRACK_CHUNK, __ATOMIC_RELAXED);
+      if (from >= hi ||
+          from > __atomic_load_n(&best, __ATOMIC_RELAXED) || !*run ||
+          crack_expired(opts)) {
+        break;
+      }
+      if (scan(crc, from, from + CRACK_CHUNK < hi ?
+               from + CRACK_CHUNK : hi, &hit) == 0) {
+        crack_atomic_min(&best, hit);
+      }
+    }
+  }
+
+  if (best != UINT64_MAX) {
+    *result = (uint32_t)best;
+    return 0;
+  }
+
+  return *run && !crack_expired(opts) ? 1 : -1;
+}
+
+int crack_bruteforce(uint32_t crc, const crack_opts_t *opts,
+                     uint32_t *result, volatile sig_atomic_t *run)
+{
+  return crack_bruteforce_range(crc, 0, CRACK_SPACE, opts, result,
+                                run) == 0 ? 0 : -1;
+}
+
+int crack_search(uint32_t crc, const crack_opts_t *opts,
+                 uint32_t *result, volatile sig_atomic_t *run)
+{
+  uint8_t in[4];
+
+  if (opts->engine == CRACK_ENGINE_SOLVE &&
+      crack_solve(crc, result) == 0) {
+    crack_candidate_bytes(*result, in);
+    if (crc32(in, sizeof(in)) == crc) {
+      return 0;
+    }
+  }
+
+  return crack_bruteforce(crc, opts, result, run);
+}
+
+/** @internal slot of crc in the target set, an empty one if absent
+ *
+ */
+static inline uint32_t crack_target_slot(const crack_targets_t *t,
+                                         uint32_t crc)
+{
+  uint32_t h = (crc * 0x9E3779B1u) & t->mask;
+
+  while (__atomic_load_n(&t->found[h], __ATOMIC_RELAXED) !=
+         CRACK_TARGET_EMPTY && t->crc[h] != crc) {
+    h = (h + 1) & t->mask;
+  }
+
+  return h;
+}
+
+/** @internal scan candidates [lo, hi) (multiples of 256) against all
+ *            targets with the fixed length formula
+ *
+ */
+static void crack_scan_targets(crack_targets_t *t, uint64_t lo,
+                               uint64_t hi)
+{
+  uint64_t i, expected;
+  uint32_t base, c, h;
+  unsigned j;
+
+  for (i = lo; i < hi; i += 256) {
+    base = crack_block_crc((uint32_t)i);
+    for (j = 0; j < 256; j++) {
+      c = base ^ crack_lin[0][j];
+      h = crack_target_slot(t, c);
+      /* every crc has exactly one candidate, it is found once */
+      expected = CRACK_TARGET_OPEN;
+      if (__atomic_load_n(&t->found[h], __ATOMIC_RELAXED) ==
+          CRACK_TARGET_OPEN &&
+          __atomic_compare_exchange_n(&t->found[h], &expected, i + j, 0,
+                                      __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        __atomic_fetch_sub(&t->remaining, 1, __ATOMIC_RELAXED);
+      }
+    }
+  }
+}
+
+/** @internal one pass over the candidate space for all n targets
+ *
+ *  @retrun 0 => all results are valid, -1 => aborted or out of memory
+ */
+static int crack_scan_batch(const uint32_t *crc, size_t n,
+                            const crack_opts_t *opts, uint32_t *result,
+                            volatile sig_atomic_t *run)
+{
+  crack_targets_t t;
+  uint64_t next = 0;
+  uint32_t slots = 16, h;
+  int threads = opts->threads, ret;
+  size_t i;
+
+  /* at most half full, the set of a full batch fits the L2 cache */
+  while (slots < 2 * n) {
+    slots *= 2;
+  }
+  t.crc = malloc(slots * sizeof(*t.crc));
+  t.found = malloc(slots * sizeof(*t.found));
+  if (t.crc == NULL || t.found == NULL) {
+    free(t.crc);
+    free(t.found);
+    return -1;
+  }
+  memset(t.found, 0xFF, slots * sizeof(*t.found));
+  t.mask = slots - 1;
+  t.remaining = 0;
+
+  /* duplicates share a slot */
+  for (i = 0; i < n; i++) {
+    h = crack_target_slot(&t, crc[i]);
+    if (t.found[h] == CRACK_TARGET_EMPTY) {
+      t.crc[h] = crc[i];
+      t.found[h] = CRACK_TARGET_OPEN;
+      t.remaining++;
+    }
+  }
+
+#ifdef _OPENMP
+  if (threads <= 0) {
+    threads = omp_get_num_procs();
+  }
+#else
+  (void)threads;
+#endif
+
+  pthread_once(&crack_once, crack_init);
+
+  /* chunks in ascending order until every target has its candidate */
+  #pragma omp parallel num_threads(threads)
+  {
+    uint64_t from;
+
+    while (1) {
+      from = __atomic_fetch_add(&next, CRACK_CHUNK, __ATOMIC_RELAXED);
+      if (from >= CRACK_SPACE ||
+          __atomic_load_n(&t.remaining, __ATOMIC_RELAXED) == 0 ||
+          !*run || crack_expired(opts)) {
+        break;
+      }
+      crack_scan_targets(&t, from, from + CRACK_CHUNK);
+    }
+  }
+
+  ret = t.remaining == 0 ? 0 : -1;
+  for (i = 0; i < n && ret == 0; i++) {
+    result[i] = (uint32_t)t.found[crack_target_slot(&t, crc[i])];
+  }
+  free(t.crc);
+  free(t.found);
+
+  return ret;
+}
+
+int crack_search_batch(const uint32_t *crc, size_t n,
+                       const crack_opts_t *opts, uint32_t *result,
+                       volatile sig_atomic_t *run)
+{
+  int threads = opts->threads;
+  int failed = 0;
+  long i;
+
+  /* scan engines: one pass over the candidates for the whole batch,
+     a single target keeps its engine */
+  if (opts->engine != CRACK_ENGINE_SOLVE) {
+    if (n == 1) {
+      return crack_search(crc[0], opts, result, run);
+    }
+    return crack_scan_batch(crc, n, opts, result, run);
+  }
+
+#ifdef _OPENMP
+  if (threads <= 0) {
+    threads = omp_get_num_procs();
+  }
+#else
+  (void)threads;
+#endif
+
+  /* independent O(1) solves, split the batch over the threads */
+  #pragma omp parallel for num_threads(threads) if(n >= 4096) \
+          schedule(static) reduction(|:failed)
+  for (i = 0; i < (long)n; i++) {
+    failed |= crack_search(crc[i], opts, &result[i], run) != 0;
+  }
+
+  return failed ? -1 : 0;
+}
+
+/** @internal register after feeding c
+ *
+ */
+static inline uint32_t crack_step(uint32_t state, uint8_t c)
+{
+  return crack_tab[(state ^ c) & 0xFF] ^ (state >> 8);
+}
+
+/** @internal register before c was fed
+ *
+ */
+static inline uint32_t crack_unstep(uint32_t state, uint8_t c)
+{
+  uint8_t j = crack_tab_inv[state >> 24];
+
+  return ((state ^ crack_tab[j]) << 8) | (uint8_t)(j ^ c);
+}
+
+/** @internal table slot of state
+ *
+ */
+static inline uint64_t crack_mitm_hash(const crack_mitm_t *m,
+                                       uint32_t state)
+{
+  return (state * UINT64_C(0x9E3779B97F4A7C15) >> 32) & m->mask;
+}
+
+/** @internal number of the first prefix leading to state
+ *
+ *  @retrun CRACK_MITM_EMPTY => none
+ */
+static uint32_t crack_mitm_lookup(const crack_mitm_t *m, uint32_t state)
+{
+  uint64_t h = crack_mitm_hash(m, state);
+
+  while (m->slot[h].prefix != CRACK_MITM_EMPTY) {
+    if (m->slot[h].state == state) {
+      return m->slot[h].prefix;
+    }
+    h = (h + 1) & m->mask;
+  }
+
+  return CRACK_MITM_EMPTY;
+}
+
+/** @internal write prefix number n as characters
+ *
+ */
+static void crack_mitm_prefix(const crack_mitm_t *m, uint32_t n,
+                              char *out)
+{
+  size_t k;
+
+  for (k = m->prefix_len; k-- > 0; n /= m->radix) {
+    out[k] = (char)m->alphabet[n % m->radix];
+  }
+}
+
+crack_mitm_t *crack_mitm_create(const char *alphabet, size_t length,
+                                size_t memory, const crack_opts_t *opts,
+                                volatile sig_atomic_t *run)
+{
+  uint8_t seen[256] = { 0 };
+  unsigned digit[CRACK_MITM_MAX_LEN];
+  uint32_t state[CRACK_MITM_MAX_LEN + 1];
+  const uint8_t *a;
+  crack_mitm_t *m;
+  uint64_t slots, n, h, count;
+  size_t k, j;
+
+  if (length == 0 || length > CRACK_MITM_MAX_LEN) {
+    errno = EINVAL;
+    return NULL;
+  }
+  if ((m = calloc(1, sizeof(*m))) == NULL) {
+    return NULL;
+  }
+  for (a = (const uint8_t *)alphabet; *a != '\0'; a++) {
+    if (!seen[*a]) {
+      seen[*a] = 1;
+      m->alphabet[m->radix++] = *a;
+    }
+  }
+  if (m->radix == 0) {
+    free(m);
+    errno = EINVAL;
+    return NULL;
+  }
+  if (memory == 0) {
+    memory = CRACK_MITM_DEFAULT_MEMORY;
+  }
+  pthread_once(&crack_once, crack_init);
+
+  /* half of the characters from the table if the budget allows it,
+     the table is kept at most half full */
+  m->length = length;
+  for (m->prefix_len = (length + 1) / 2; m->prefix_len > 0;
+       m->prefix_len--) {
+    for (count = 1, k = 0; k < m->prefix_len &&
+         count <= CRACK_MITM_MAX_SLOTS; k++) {
+      count *= m->radix;
+    }
+    for (slots = CRACK_MITM_MIN_SLOTS; slots < 2 * count &&
+         slots <= CRACK_MITM_MAX_SLOTS; slots *= 2) {
+    }
+    if (slots <= CRACK_MITM_MAX_SLOTS &&
+        slots * sizeof(crack_mitm_slot_t) <= memory) {
+      break;
+    }
+  }
+  if (m->prefix_len == 0) {
+    count = 1;
+    slots = CRACK_MITM_MIN_SLOTS;
+  }
+  m->prefixes = count;
+  m->mask = slots - 1;
+  if ((m->slot = malloc(slots * sizeof(crack_mitm_slot_t))) == NULL) {
+    free(m);
+    return NULL;
+  }
+  memset(m->slot, 0xFF, slots * sizeof(crack_mitm_slot_t));
+
+  /* all prefixes in counting order, the last character changes
+     fastest and only the registers behind a changed one are redone */
+  memset(digit, 0, sizeof(digit));
+  state[0] = CRC32_INIT;
+  for (j = 0; j < m->prefix_len; j++) {
+    state[j + 1] = crack_step(state[j], m->alphabet[0]);
+  }
+  for (n = 0; n < count; n++) {
+    if (n % CRACK_MITM_POLL == 0 && (!*run || crack_expired(opts))) {
+      crack_mitm_destroy(m);
+      errno = ECANCELED;
+      return NULL;
+    }
+    h = crack_mitm_hash(m, state[m->prefix_len]);
+    while (m->slot[h].prefix != CRACK_MITM_EMPTY &&
+           m->slot[h].state != state[m->prefix_len]) {
+      h = (h + 1) & m->mask;
+    }
+    if (m->slot[h].prefix == CRACK_MITM_EMPTY) {
+      m->slot[h].state = state[m->prefix_len];
+      m->slot[h].prefix = (uint32_t)n;
+    }
+
+    for (k = m->prefix_len; k > 0 && ++digit[k - 1] == m->radix; k--) {
+      digit[k - 1] = 0;
+    }
+    for (j = k > 0 ? k - 1 : 0; j < m->prefix_len; j++) {
+      state[j + 1] = crack_step(state[j], m->alphabet[digit[j]]);
+    }
+  }
+
+  return m;
+}
+
+void crack_mitm_destroy(crack_mitm_t *m)
+{
+  if (m == NULL) {
+    return;
+  }
+
+  free(m->slot);
+  free(m);
+}
+
+size_t crack_mitm_prefix_len(const crack_mitm_t *m)
+{
+  return m->prefix_len;
+}
+
+int crack_mitm_search(const crack_mitm_t *m, uint32_t crc,
+                      const crack_opts_t *opts, char *result,
+                      volatile sig_atomic_t *run)
+{
+  size_t suffix_len = m->length - m->prefix_len;
+  uint32_t target = crc32_final(crc);
+  uint32_t n;
+  long best = -1, last;
+  int threads = opts->threads;
+
+  result[m->length] = '\0';
+
+  /* nothing to walk, the table has the whole string */
+  if (suffix_len == 0) {
+    if ((n = crack_mitm_lookup(m, target)) == CRACK_MITM_EMPTY) {
+      return 1;
+    }
+    crack_mitm_prefix(m, n, result);
+    return 0;
+  }
+
+#ifdef _OPENMP
+  if (threads <= 0) {
+    threads = omp_get_num_procs();
+  }
+#else
+  (void)threads;
+#endif
+
+  /* The last character is fixed per task and walked back first.  The
+     task with the lowest character that has a match wins, so the
+     result does not depend on the thread count. */
+  #pragma omp parallel for num_threads(threads) schedule(dynamic, 1)
+  for (last = 0; last < (long)m->radix; last++) {
+    unsigned digit[CRACK_MITM_MAX_LEN];
+    uint32_t mid[CRACK_MITM_MAX_LEN + 1];
+    uint32_t prefix, steps = 0;
+    long cur;
+    size_t k, j;
+
+    cur = __atomic_load_n(&best, __ATOMIC_RELAXED);
+    if ((cur >= 0 && cur < last) || !*run || crack_expired(opts)) {
+      continue;
+    }
+
+    /* mid[j] = register in front of suffix character j */
+    memset(digit, 0, sizeof(digit));
+    digit[suffix_len - 1] = (unsigned)last;
+    mid[suffix_len] = target;
+    for (j = suffix_len; j-- > 0; ) {
+      mid[j] = crack_unstep(mid[j + 1], m->alphabet[digit[j]]);
+    }
+
+    while (1) {
+      if ((prefix = crack_mitm_lookup(m, mid[0])) != CRACK_MITM_EMPTY) {
+        #pragma omp critical(crack_mitm_result)
+        {
+          cur = __atomic_load_n(&best, __ATOMIC_RELAXED);
+          if (cur < 0 || last < cur) {
+            crack_mitm_prefix(m, prefix, result);
+            for (j = 0; j < suffix_len; j++) {
+              result[m->prefix_len + j] = (char)m->alphabet[digit[j]];
+            }
+            __atomic_store_n(&best, last, __ATOMIC_RELAXED);
+          }
+        }
+        break;
+      }
+
+      /* next suffix, character 0 changes fastest */
+      for (k = 0; k + 1 < suffix_len && ++digit[k] == m->radix; k++) {
+        digit[k] = 0;
+      }
+      if (k + 1 >= suffix_len) {
+        break;
+      }
+      for (j = k + 1; j-- > 0; ) {
+        mid[j] = crack_unstep(mid[j + 1], m->alphabet[digit[j]]);
+      }
+
+      if (++steps % CRACK_MITM_POLL == 0) {
+        cur = __atomic_load_n(&best, __ATOMIC_RELAXED);
+        if ((cur >= 0 && cur < last) || !*run || crack_expired(opts)) {
+          break;
+        }
+      }
+    }
+  }
+
+  if (best >= 0) {
+    return 0;
+  }
+
+  return *run && !crack_expired(opts) ? 1 : -1;
+}
+
+const char *crack_engine_name(crack_engine_t engine)
+{
+  switch (engine) {
+  case CRACK_ENGINE_SOLVE:
+    return "solve";
+  case CRACK_ENGINE_BRUTE:
+    return "brute";
+  case CRACK_ENGINE_SIMD:
+    return "simd";
+  case CRACK_ENGINE_GRAY:
+    return "gray";
+  }
+
+  return "unknown";
+}
+
+int crack_engine_parse(const char *name, crack_engine_t *engine)
+{
+  if (strcmp(name, "solve") == 0) {
+    *engine = CRACK_ENGINE_SOLVE;
+  } else if (strcmp(name, "brute") == 0) {
+    *engine = CRACK_ENGINE_BRUTE;
+  } else if (strcmp(name, "simd") == 0) {
+    *engine = CRACK_ENGINE_SIMD;
+  } else if (strcmp(name, "gray") == 0) {
+    *engine = CRACK_ENGINE_GRAY;
+  } else {
+    return -1;
+  }
+
+  return 0;
+}
+
+/*EOF*/
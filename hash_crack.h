@@ -0,0 +1,165 @@
+/**
+ * @file hash_crack.h
+ * @date 17 Oct 2026
+ * @brief Collision search engine shared by the hash cracker tools
+ *
+ *        A candidate i stands for the 4 byte input
+ *        {i>>24, i>>16, i>>8, i}, the engines look for the candidate
+ *        whose crc32 equals a given target crc.
+ *
+ */
+
+#ifndef HASH_CRACK_H
+#define HASH_CRACK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define CRACK_MITM_MAX_LEN          256
+#define CRACK_MITM_DEFAULT_MEMORY   ((size_t)256 << 20)
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+
+/** @brief available search engines
+ *
+ *  All engines return the same (lowest) matching candidate.
+ */
+typedef enum crack_engine_e {
+  CRACK_ENGINE_SOLVE = 0,   /* algebraic inversion, O(1) */
+  CRACK_ENGINE_BRUTE,       /* linear scan over all candidates */
+  CRACK_ENGINE_SIMD,        /* linear scan, vectorised formula */
+  CRACK_ENGINE_GRAY         /* Gray code order, one xor per step */
+} crack_engine_t;
+
+/** @brief search parameters
+ *
+ *  threads is the number of OpenMP threads a brute force search is
+ *  split across, <= 0 uses all CPUs.  A search gives up once
+ *  CLOCK_MONOTONIC passes deadline (in ns, 0 => no deadline), it is
+ *  checked with the run flag once per chunk of candidates.
+ */
+typedef struct crack_opts_s {
+  crack_engine_t engine;
+  int threads;
+  uint64_t deadline;
+} crack_opts_t;
+
+/** @brief meet-in-the-middle table for collisions of one alphabet and
+ *         length, it does not depend on the target crc
+ */
+typedef struct crack_mitm_s crack_mitm_t;
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @brief store the 4 input bytes of candidate i in out */
+void crack_candidate_bytes(uint32_t i, uint8_t out[4]);
+
+/** @brief compute the colliding candidate by inverting crc32
+ *
+ *  @retrun 0 => result is valid
+ */
+int crack_solve(uint32_t crc, uint32_t *result);
+
+/** @brief scan the candidates in ascending order
+ *
+ *  opts->engine selects the scan kernel, CRACK_ENGINE_SOLVE uses the
+ *  fastest one.  The candidate space is cut into chunks which are
+ *  handed out in ascending order to the threads, the lowest match is
+ *  returned independent of the thread count.
+ *
+ *  @param run search is aborted as soon as *run becomes 0
+ *
+ *  @retrun 0 => result is valid, -1 => aborted (run or deadline)
+ */
+int crack_bruteforce(uint32_t crc, const crack_opts_t *opts,
+                     uint32_t *result, volatile sig_atomic_t *run);
+
+/** @brief crack_bruteforce() restricted to the candidates [lo, hi)
+ *
+ *  Returns the lowest match inside the range, used to split one
+ *  search across several processes.
+ *
+ *  @retrun 0 => result is valid, 1 => no match in the range,
+ *          -1 => aborted (run or deadline)
+ */
+int crack_bruteforce_range(uint32_t crc, uint64_t lo, uint64_t hi,
+                           const crack_opts_t *opts, uint32_t *result,
+                           volatile sig_atomic_t *run);
+
+/** @brief search with the given engine
+ *
+ *  The solver result is verified with crc32(), on a mismatch the
+ *  brute force is used as fallback.
+ *
+ *  @retrun 0 => result is valid, -1 => aborted (run or deadline)
+ */
+int crack_search(uint32_t crc, const crack_opts_t *opts,
+                 uint32_t *result, volatile sig_atomic_t *run);
+
+/** @brief crack_search() for n targets
+ *
+ *  Solver batches are split across opts->threads.  The scan engines
+ *  walk the candidates once for the whole batch and look each one up
+ *  in a hash set of the targets (fixed length formula, any scan
+ *  engine), so a batch costs about one scan; a single target uses
+ *  the engine itself.
+ *
+ *  @retrun 0 => all results are valid, -1 => aborted (run or deadline)
+ */
+int crack_search_batch(const uint32_t *crc, size_t n,
+                       const crack_opts_t *opts, uint32_t *result,
+                       volatile sig_atomic_t *run);
+
+/** @brief build the table for collisions of length characters taken
+ *         from alphabet (duplicates are ignored)
+ *
+ *  The table covers the first half of the characters if that fits
+ *  into memory bytes (0 => CRACK_MITM_DEFAULT_MEMORY), otherwise as
+ *  many as fit; the search walks the rest.  The build stops early
+ *  like a search when *run becomes 0 or opts->deadline passes.
+ *
+ *  @retrun NULL => invalid arguments (EINVAL), out of memory
+ *          (ENOMEM) or aborted (ECANCELED)
+ */
+crack_mitm_t *crack_mitm_create(const char *alphabet, size_t length,
+                                size_t memory, const crack_opts_t *opts,
+                                volatile sig_atomic_t *run);
+void crack_mitm_destroy(crack_mitm_t *m);
+
+/** @brief number of characters the table resolves */
+size_t crack_mitm_prefix_len(const crack_mitm_t *m);
+
+/** @brief find a string from the table's alphabet and length whose
+ *         crc32 is crc
+ *
+ *  The suffixes are split across opts->threads, the result does not
+ *  depend on the thread count.
+ *
+ *  @param result receives the string, length + 1 bytes
+ *
+ *  @retrun 0 => result is valid, 1 => no such string,
+ *          -1 => aborted (run or deadline)
+ */
+int crack_mitm_search(const crack_mitm_t *m, uint32_t crc,
+                      const crack_opts_t *opts, char *result,
+                      volatile sig_atomic_t *run);
+
+/** @brief vector unit used by CRACK_ENGINE_SIMD (avx512, avx2, scalar)
+ */
+const char *crack_simd_name(void);
+
+/** @brief engine name <-> id
+ *
+ *  @retrun crack_engine_parse: 0 => known name, -1 => unknown
+ */
+const char *crack_engine_name(crack_engine_t engine);
+int crack_engine_parse(const char *name, crack_engine_t *engine);
+
+#endif
+
+/*EOF*/
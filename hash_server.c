@@ -4,8 +4,10 @@
  * @date 19 Nov 2016
  * @brief File contains server functionallity for the hash cracker client
  *
- * @usage gcc hash_server.c crc32.c -o hash_server -Wall
- *                          -pedantic-errors -lpthread
+ * @usage gcc hash_server.c crc32.c hash_crack.c result_cache.c
+ *            thread_pool.c async_log.c metrics.c cluster.c -o hash_server
+ *            -Wall -pedantic-errors
+ *            -lpthread -fopenmp
  *
  *        astyle -A3 --max-code-length=70 --indent=spaces=2 hash_server.c
  *
@@ -31,175 +33,1684 @@
 #include <unistd.h>
 #include <inttypes.h>
 #include <time.h>
-#include <sys/ipc.h>
-#include <sys/msg.h>
-#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/uio.h>
+#include <sys/select.h>
+#include <fcntl.h>
 #include <omp.h>
 #include "crc32.h"
+#include "hash_crack.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+#include "async_log.h"
+#include "metrics.h"
+#include "cluster.h"
 
 #include <netdb.h>
 #include <resolv.h>
 
 /* include shared defines */
 #include "shared_defines.h"
+#include "protocol.h"
 
 /*****************************************************************************/
 /******************************************************************* defines */
 #define TRUE   1
 #define FALSE  0
 
-#define MQ_TYPE_OPEN_CON        1
-#define MQ_TYPE_CLOSE_CON       2
-#define MQ_TYPE_TERMINATE       3
-#define MQ_KEY                  1992
+#define LOG_OPEN_CON            1
+#define LOG_CLOSE_CON           2
+#define LOG_JOIN_CON            3
+
+#define DEFAULT_CACHE_SIZE      65536
+#define DEFAULT_QUEUE_LEN       1024
+#define DEFAULT_BACKLOG         SOMAXCONN
+#define DEFAULT_REACTORS        1
+#define DEFAULT_LOG_RECORDS     8192
+#define DEFAULT_STATS_INTERVAL  60
+#define DEFAULT_CLUSTER_DEPTH   2
+#define DEFAULT_MITM_MB         256
+
+#define MAX_WEIGHTS             64
+#define MAX_PEERS               64
+#define BATCH_COST_ITEMS        64
+
+#define MAX_EVENTS              256
+#define READ_BUF                16384
+#define IN_BUF_KEEP             65536
+#define OUT_BUF_MAX             1048576
+#define MAX_IOV                 64
+#define STATS_BUF               2048
 
 /*****************************************************************************/
 /******************************************************************* globals */
 volatile sig_atomic_t run = 1;
+static crack_opts_t crack_opts = { CRACK_ENGINE_SOLVE, 1 };
+static result_cache_t *cache = NULL;
+static metrics_t *metrics = NULL;
+static cluster_t *cluster = NULL;
+
+/* table of the last CRACK_STRING, reused while requests ask for the
+   same alphabet and length; the lock only guards swapping it and the
+   reference counts, tables are built and searched without it */
+static pthread_mutex_t mitm_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct mitm_table_s *mitm = NULL;
+static size_t mitm_memory = (size_t)DEFAULT_MITM_MB << 20;
+
+/* share of the workers per client address (-W), 1 for all others */
+static struct in_addr weight_addr[MAX_WEIGHTS];
+static int weight_value[MAX_WEIGHTS];
+static int weight_count = 0;
+
+/* worker addresses allowed to register (-A), none => no cluster */
+static struct in_addr peer_addr[MAX_PEERS];
+static int peer_count = 0;
 
 /*****************************************************************************/
 /******************************************************************** typedef*/
+struct conn_s;
+struct reactor_s;
+
+/* a meet-in-the-middle table with its key, refs counts the global
+   pointer and every search still walking it; a replaced table lives
+   until its last search is done */
+typedef struct mitm_table_s {
+  crack_mitm_t *m;
+  char *alphabet;
+  uint32_t length;
+  int refs;
+} mitm_table_t;
+
+/* the payload is hashed by the reactor while it is still in the
+   receive buffer, a job only carries the crc to crack; a batch job
+   carries count crcs in an allocated array instead.  A range job of
+   the cluster mode scans first..last.  A string job looks for a
+   collision of length characters from alphabet.  Every job sits on
+   the active list of its connection until it is done, a CANCEL or a
+   disconnect clears active, which the search polls like the run flag;
+   a search past deadline (metrics_now() ns, 0 => none) gives up */
 typedef struct thread_job_s {
-  char data[1024];
-  int len;
-  int socket_fd;
+  uint32_t crc;
+  uint32_t *batch;
+  uint32_t count;
+  uint32_t id;
+  char *alphabet;
+  uint32_t length;
+  int range;
+  uint32_t first;
+  uint32_t last;
+  volatile sig_atomic_t active;
+  struct thread_job_s *active_next;
+  uint64_t deadline;
+  uint64_t queued;
+  struct conn_s *conn;
 } thread_job_t;
 
-typedef struct log_msg_s {
-  long type;
-  char port[20];
-} log_msg_t;
+/* one queued response, data[off..len) is still unsent */
+typedef struct out_chunk_s {
+  struct out_chunk_s *next;
+  uint64_t queued;
+  size_t len;
+  size_t off;
+  uint8_t data[];
+} out_chunk_t;
+
+/* one client connection, in[] collects bytes until a frame is
+   complete, out_head..out_tail holds the responses not yet written.
+   Workers only append under out_lock and hand the connection to its
+   reactor, the reactor alone writes to the socket. refs counts the
+   reactor table entry, every queued job, a pending flush and the
+   cluster while the peer is a registered worker.  While body_job is
+   set the next body_left bytes are the body of a CRACK_STREAM, they
+   go into the crc of the job instead of being parsed as frames.  The
+   jobs of a connection are queued on its flow of the pool, the workers
+   take the flows in turns */
+typedef struct conn_s {
+  int fd;
+  struct sockaddr_in addr;
+  struct reactor_s *reactor;
+  int refs;
+  uint8_t *in;
+  size_t in_len;
+  size_t in_cap;
+  pthread_mutex_t out_lock;
+  out_chunk_t *out_head;
+  out_chunk_t *out_tail;
+  size_t out_bytes;
+  int closed;
+  int flush_queued;
+  int want_write;
+  int read_paused;
+  int cluster_peer;
+  int coordinator;
+  thread_job_t *jobs;
+  thread_job_t *body_job;
+  uint64_t body_left;
+  thread_pool_flow_t *flow;
+  struct conn_s *ready_next;
+} conn_t;
+
+/* epoll event loop and the connections it serves, conn[] is indexed
+   by file descriptor and grows on demand; every reactor thread owns
+   its listening socket (SO_REUSEPORT) and its connections */
+typedef struct reactor_s {
+  int id;
+  pthread_t thread;
+  int epfd;
+  int listen_fd;
+  int wake_fd;
+  conn_t **conn;
+  int conn_cap;
+  int conn_count;
+  thread_pool_t *pool;
+  async_log_t *log;
+  pthread_mutex_t ready_lock;
+  conn_t *ready;
+  uint64_t accepted;
+  uint64_t requests;
+} reactor_t;
 
 /*****************************************************************************/
 /****************************************************************** functions*/
 
-/** @internal get formatet time string
+/** @internal wake a reactor blocked in epoll_wait()
  *
  */
-static char* get_local_time(void)
+static void reactor_wake(reactor_t *r)
 {
+  uint64_t one = 1;
 
-  time_t rawtime;
-  struct tm *timeinfo;
-  char *pos = NULL;
-  char *time_str = NULL;
+  if (write(r->wake_fd, &one, sizeof(one)) < 0) {
+    perror("eventfd");
+  }
+}
+
+/** @internal take a reference on a connection
+ *
+ */
+static void conn_get(conn_t *c)
+{
+  __atomic_add_fetch(&c->refs, 1, __ATOMIC_RELAXED);
+}
+
+/** @internal drop a reference, the last one frees the connection
+ *
+ */
+static void conn_put(conn_t *c)
+{
+  out_chunk_t *o;
+
+  if (__atomic_sub_fetch(&c->refs, 1, __ATOMIC_ACQ_REL) != 0) {
+    return;
+  }
+
+  while ((o = c->out_head) != NULL) {
+    c->out_head = o->next;
+    free(o);
+  }
+  pthread_mutex_destroy(&c->out_lock);
+  thread_pool_flow_destroy(c->flow);
+  free(c->in);
+  free(c);
+}
+
+/** @internal append head and body as one chunk to the output queue
+ *
+ *  @retrun 0 => queued, -1 => connection closed or out of memory
+ */
+static int conn_append(conn_t *c, const void *head, size_t head_len,
+                       const void *body, size_t body_len)
+{
+  out_chunk_t *o;
+
+  if ((o = malloc(sizeof(*o) + head_len + body_len)) == NULL) {
+    perror("malloc");
+    return -1;
+  }
+  o->next = NULL;
+  o->len = head_len + body_len;
+  o->off = 0;
+  o->queued = metrics_now();
+  memcpy(o->data, head, head_len);
+  if (body_len > 0) {
+    memcpy(o->data + head_len, body, body_len);
+  }
+
+  pthread_mutex_lock(&c->out_lock);
+  if (c->closed) {
+    pthread_mutex_unlock(&c->out_lock);
+    free(o);
+    return -1;
+  }
+  if (c->out_tail != NULL) {
+    c->out_tail->next = o;
+  } else {
+    c->out_head = o;
+  }
+  c->out_tail = o;
+  c->out_bytes += o->len;
+  pthread_mutex_unlock(&c->out_lock);
+
+  return 0;
+}
+
+/** @internal queue one frame, the reactor writes it later
+ *
+ *  @retrun 0 => queued, -1 => connection closed or out of memory
+ */
+static int conn_queue(conn_t *c, uint16_t type, uint32_t id,
+                      const void *payload, size_t len)
+{
+  uint8_t hdr_buf[PROTO_HDR_LEN];
+  proto_hdr_t hdr;
+
+  hdr.len = (uint32_t)len;
+  hdr.id = id;
+  hdr.type = type;
+  hdr.flags = 0;
+  proto_pack_hdr(hdr_buf, &hdr);
+
+  if (type == PROTO_BUSY) {
+    metrics_add(metrics, METRIC_BUSY, 1);
+  } else if (type == PROTO_ERROR) {
+    metrics_add(metrics, METRIC_ERRORS, 1);
+  } else if (type == PROTO_TIMEOUT) {
+    metrics_add(metrics, METRIC_TIMEOUTS, 1);
+  }
+
+  return conn_append(c, hdr_buf, PROTO_HDR_LEN, payload, len);
+}
+
+/** @internal queue a text frame from the reactor thread
+ *
+ */
+static void conn_queue_text(conn_t *c, uint16_t type, uint32_t id,
+                            const char *text)
+{
+  conn_queue(c, type, id, text, text ? strlen(text) : 0);
+}
+
+/** @internal unsent output of c in bytes
+ *
+ */
+static size_t conn_pending(conn_t *c)
+{
+  size_t bytes;
+
+  pthread_mutex_lock(&c->out_lock);
+  bytes = c->out_bytes;
+  pthread_mutex_unlock(&c->out_lock);
+
+  return bytes;
+}
+
+/** @internal send one frame to a client from a worker thread
+ *
+ *  The frame is queued and the connection put on the ready list of
+ *  its reactor, which flushes it. A connection is on the list at most
+ *  once, replies queued meanwhile go out with the same writev().
+ */
+static void send_frame(conn_t *c, uint16_t type, uint32_t id,
+                       const void *payload, size_t len)
+{
+  reactor_t *r = c->reactor;
+  int schedule, wake;
+
+  if (conn_queue(c, type, id, payload, len) != 0) {
+    return;
+  }
+
+  pthread_mutex_lock(&c->out_lock);
+  schedule = !c->flush_queued;
+  c->flush_queued = 1;
+  pthread_mutex_unlock(&c->out_lock);
+  if (!schedule) {
+    return;
+  }
+
+  /* the list holds a reference until the reactor took it off */
+  conn_get(c);
+  pthread_mutex_lock(&r->ready_lock);
+  c->ready_next = r->ready;
+  r->ready = c;
+  wake = (c->ready_next == NULL);
+  pthread_mutex_unlock(&r->ready_lock);
+
+  /* a non-empty list already has a wakeup pending */
+  if (wake) {
+    reactor_wake(r);
+  }
+}
+
+/** @internal send a text frame to a client from a worker thread
+ *
+ */
+static void send_text(conn_t *c, uint16_t type, uint32_t id,
+                      const char *text)
+{
+  send_frame(c, type, id, text, text ? strlen(text) : 0);
+}
+
+/** @internal abort the queued and running jobs of c, all or the one
+ *            with the request id
+ *
+ */
+static void conn_cancel(conn_t *c, int all, uint32_t id)
+{
+  thread_job_t *job;
+
+  pthread_mutex_lock(&c->out_lock);
+  for (job = c->jobs; job != NULL; job = job->active_next) {
+    if (all || job->id == id) {
+      job->active = 0;
+    }
+  }
+  pthread_mutex_unlock(&c->out_lock);
+}
+
+/** @internal send callback of the cluster, peers are connections
+ *
+ */
+static void cluster_send(void *peer, uint16_t type, uint32_t id,
+                         const void *payload, size_t len)
+{
+  send_frame((conn_t *)peer, type, id, payload, len);
+}
+
+/** @internal scan the candidates of a CRACK_RANGE request
+ *
+ */
+static void hash_cracker_range(thread_job_t *job,
+                               const crack_opts_t *opts)
+{
+  uint8_t payload[8];
+  uint32_t hit = 0, status;
+  int ret;
+
+  ret = crack_bruteforce_range(job->crc, job->first,
+                               (uint64_t)job->last + 1, opts, &hit,
+                               &job->active);
+  status = ret == 0 ? PROTO_RANGE_FOUND :
+           ret > 0 ? PROTO_RANGE_NONE : PROTO_RANGE_CANCELLED;
+
+  /* cancelled or not, the coordinator counts on one answer */
+  proto_put_u32(payload, status);
+  proto_put_u32(payload + 4, hit);
+  send_frame(job->conn, PROTO_RANGE_RESULT, job->id, payload,
+             sizeof(payload));
+}
+
+/** @internal drop a reference to t, mitm_lock must be held
+ *
+ */
+static void mitm_put(mitm_table_t *t)
+{
+  if (--t->refs > 0) {
+    return;
+  }
+  crack_mitm_destroy(t->m);
+  free(t->alphabet);
+  free(t);
+}
+
+/** @internal find a collision from the alphabet of a string job
+ *
+ *  @retrun 0 => answered, -1 => aborted
+ */
+static int hash_cracker_string(thread_job_t *job, const crack_opts_t *opts)
+{
+  char result[CRACK_MITM_MAX_LEN + 1];
+  mitm_table_t *t;
+  int ret;
+
+  /* the cached table if the key matches */
+  pthread_mutex_lock(&mitm_lock);
+  if ((t = mitm) != NULL && t->length == job->length &&
+      strcmp(t->alphabet, job->alphabet) == 0) {
+    t->refs++;
+  } else {
+    t = NULL;
+  }
+  pthread_mutex_unlock(&mitm_lock);
+
+  /* else build one without the lock, the other requests go on and a
+     cancel or the deadline stops the build */
+  if (t == NULL) {
+    if ((t = calloc(1, sizeof(*t))) == NULL ||
+        (t->m = crack_mitm_create(job->alphabet, job->length, mitm_memory,
+                                  opts, &job->active)) == NULL) {
+      ret = errno;
+      free(t);
+      if (ret == ECANCELED) {
+        return -1;
+      }
+      send_text(job->conn, PROTO_ERROR, job->id, ret == EINVAL ?
+                "invalid alphabet or length" : "out of memory");
+      return 0;
+    }
+    t->alphabet = job->alphabet;
+    t->length = job->length;
+    t->refs = 1;
+    job->alphabet = NULL;
+
+    /* swap it in, unless another request built the same meanwhile */
+    pthread_mutex_lock(&mitm_lock);
+    if (mitm != NULL && mitm->length == t->length &&
+        strcmp(mitm->alphabet, t->alphabet) == 0) {
+      mitm_put(t);
+      t = mitm;
+    } else {
+      if (mitm != NULL) {
+        mitm_put(mitm);
+      }
+      mitm = t;
+    }
+    t->refs++;
+    pthread_mutex_unlock(&mitm_lock);
+  }
+
+  ret = crack_mitm_search(t->m, job->crc, opts, result, &job->active);
+
+  pthread_mutex_lock(&mitm_lock);
+  mitm_put(t);
+  pthread_mutex_unlock(&mitm_lock);
+
+  if (ret == 0) {
+    send_text(job->conn, PROTO_STRING_RESULT, job->id, result);
+  } else if (ret > 0) {
+    send_text(job->conn, PROTO_ERROR, job->id,
+              "no collision of that length");
+  }
+
+  return ret < 0 ? -1 : 0;
+}
+
+/** @internal crack a batch job, answer with one BATCH_RESULT
+ *
+ *  @retrun 0 => answered, -1 => aborted
+ */
+static int hash_cracker_batch(thread_job_t *job, const crack_opts_t *opts)
+{
+  uint32_t *miss_crc = NULL, *miss_res = NULL, *miss_pos = NULL;
+  uint8_t *payload;
+  uint32_t i, misses = 0, value;
+  int ret = 0;
+
+  payload = malloc(4 + 4 * (size_t)job->count);
+  miss_crc = malloc(job->count * sizeof(uint32_t));
+  miss_res = malloc(job->count * sizeof(uint32_t));
+  miss_pos = malloc(job->count * sizeof(uint32_t));
+  if (payload == NULL || miss_crc == NULL || miss_res == NULL ||
+      miss_pos == NULL) {
+    send_text(job->conn, PROTO_ERROR, job->id, "out of memory");
+    goto out;
+  }
+
+  /* answer what is cached, search the rest as one batch */
+  proto_put_u32(payload, job->count);
+  for (i = 0; i < job->count; i++) {
+    if (result_cache_get(cache, job->batch[i], &value) == 0) {
+      proto_put_u32(payload + 4 + 4 * i, value);
+    } else {
+      miss_crc[misses] = job->batch[i];
+      miss_pos[misses++] = i;
+    }
+  }
+
+  if (misses > 0 && crack_search_batch(miss_crc, misses, opts, miss_res,
+                                       &job->active) != 0) {
+    ret = -1;
+    goto out;
+  }
+  for (i = 0; i < misses; i++) {
+    result_cache_put(cache, miss_crc[i], miss_res[i]);
+    proto_put_u32(payload + 4 + 4 * miss_pos[i], miss_res[i]);
+  }
+
+  send_frame(job->conn, PROTO_BATCH_RESULT, job->id, payload,
+             4 + 4 * (size_t)job->count);
+
+out:
+  free(payload);
+  free(miss_crc);
+  free(miss_res);
+  free(miss_pos);
+
+  return ret;
+}
+
+/** @internal a job gave up: answer TIMEOUT if its deadline passed,
+ *            a cancelled job gets no answer
+ *
+ */
+static void hash_cracker_abort(thread_job_t *job)
+{
+  if (job->active && job->deadline != 0 &&
+      metrics_now() >= job->deadline) {
+    send_text(job->conn, PROTO_TIMEOUT, job->id, NULL);
+  } else {
+    metrics_add(metrics, METRIC_CANCELLED, 1);
+  }
+}
+
+/** @brief crack job, executed by a worker of the thread pool
+ *
+ */
+static void hash_cracker(void *ptr)
+{
+
+  thread_job_t *job = (thread_job_t *)ptr;
+  thread_job_t **pj;
+  crack_opts_t opts = crack_opts;
+  uint32_t orig_crc = job->crc;
+  uint64_t start = metrics_now();
+  char result[16];
+  uint32_t i = 0;
+  int ret = 0;
+
+  metrics_record(metrics, METRIC_QUEUE_WAIT, start - job->queued);
+
+  /* jobs still queued at ^C stop right away */
+  if (!run) {
+    job->active = 0;
+  }
+  opts.deadline = job->deadline;
+
+  if (job->range) {
+    hash_cracker_range(job, &opts);
+    goto out;
+  }
+  /* expired while queued */
+  if (!job->active || (job->deadline != 0 && start >= job->deadline)) {
+    ret = -1;
+    goto out;
+  }
+  if (job->batch != NULL) {
+    ret = hash_cracker_batch(job, &opts);
+    goto out;
+  }
+  if (job->length > 0) {
+    ret = hash_cracker_string(job, &opts);
+    goto out;
+  }
+
+  /* search for equal hash code unless the answer is cached, a scan
+     goes to the cluster workers if there are any */
+  if (result_cache_get(cache, orig_crc, &i) != 0) {
+    ret = 1;
+    if (crack_opts.engine != CRACK_ENGINE_SOLVE) {
+      ret = cluster_search(cluster, orig_crc, job->deadline, &i,
+                           &job->active);
+    }
+    if (ret == 2) {
+      send_text(job->conn, PROTO_ERROR, job->id, "cluster search failed");
+      goto out;
+    }
+    if (ret > 0) {
+      ret = crack_search(orig_crc, &opts, &i, &job->active);
+    }
+    if (ret < 0) {
+      goto out;
+    }
+    result_cache_put(cache, orig_crc, i);
+  }
+
+  /* format result in string */
+  sprintf(result, "0x%08"PRIx32, i);
+
+  /* send result to client, tagged with the request id */
+  send_text(job->conn, PROTO_RESULT, job->id, result);
+
+out:
+  if (ret < 0) {
+    hash_cracker_abort(job);
+  }
+  free(job->batch);
+  job->batch = NULL;
+  free(job->alphabet);
+  job->alphabet = NULL;
+
+  pthread_mutex_lock(&job->conn->out_lock);
+  for (pj = &job->conn->jobs; *pj != job; pj = &(*pj)->active_next) {
+  }
+  *pj = job->active_next;
+  pthread_mutex_unlock(&job->conn->out_lock);
+
+  metrics_record(metrics, METRIC_SEARCH, metrics_now() - start);
+  metrics_add(metrics, METRIC_JOBS_DONE, 1);
+  metrics_gauge_add(metrics, METRIC_INFLIGHT, -1);
+
+  /* reference taken by reactor_dispatch() */
+  conn_put(job->conn);
+  job->conn = NULL;
+}
+
+/** @internal hand a job to the workers, a batch costs its flow one
+ *            turn per BATCH_COST_ITEMS crcs
+ *
+ */
+static void reactor_submit(reactor_t *r, thread_job_t *job)
+{
+  job->queued = metrics_now();
+  metrics_gauge_add(metrics, METRIC_INFLIGHT, 1);
+  thread_pool_submit_cost(r->pool, job, job->batch != NULL ?
+                          1 + job->count / BATCH_COST_ITEMS : 1);
+}
+
+/** @internal drop the CRACK_STREAM body still being received, its job
+ *            was cancelled and only gives back its slot
+ *
+ */
+static void reactor_body_drop(reactor_t *r, conn_t *c)
+{
+  if (c->body_job != NULL) {
+    reactor_submit(r, c->body_job);
+    c->body_job = NULL;
+    c->body_left = 0;
+  }
+}
+
+/** @internal queue a connect/disconnect event for the log file
+ *
+ */
+static void log_event(async_log_t *log, int type,
+                      const struct sockaddr_in *addr)
+{
+  async_log_printf(log, type == LOG_OPEN_CON ?
+                   "Client connected on port number: %d" :
+                   type == LOG_JOIN_CON ?
+                   "Cluster link on port number: %d" :
+                   "Client diconnected on port number: %d",
+                   ntohs(addr->sin_port));
+}
+
+/** @internal switch a socket to non-blocking mode
+ *
+ */
+static int set_nonblocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL, 0);
+
+  if (flags < 0) {
+    return -1;
+  }
+
+  return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/** @internal weight of a client address given with -W, default 1
+ *
+ */
+static int client_weight(const struct sockaddr_in *addr)
+{
+  int i;
+
+  for (i = 0; i < weight_count; i++) {
+    if (weight_addr[i].s_addr == addr->sin_addr.s_addr) {
+      return weight_value[i];
+    }
+  }
+
+  return 1;
+}
+
+/** @internal may the client at addr register as cluster worker (-A)
+ *
+ */
+static int peer_allowed(const struct sockaddr_in *addr)
+{
+  int i;
+
+  for (i = 0; i < peer_count; i++) {
+    if (peer_addr[i].s_addr == addr->sin_addr.s_addr) {
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/** @internal register a new connection with the reactor
+ *
+ *  @retrun NULL => out of memory or epoll error
+ */
+static conn_t *reactor_add(reactor_t *r, int fd,
+                           const struct sockaddr_in *addr)
+{
+  struct epoll_event ev;
+  conn_t **table;
+  conn_t *c;
+  int cap;
+
+  /* grow fd indexed table */
+  if (fd >= r->conn_cap) {
+    for (cap = r->conn_cap ? r->conn_cap : 64; cap <= fd; cap *= 2) {
+    }
+    table = realloc(r->conn, cap * sizeof(conn_t *));
+    if (table == NULL) {
+      return NULL;
+    }
+    memset(table + r->conn_cap, 0,
+           (cap - r->conn_cap) * sizeof(conn_t *));
+    r->conn = table;
+    r->conn_cap = cap;
+  }
+
+  if ((c = calloc(1, sizeof(*c))) == NULL) {
+    return NULL;
+  }
+  if ((c->flow = thread_pool_flow_create(client_weight(addr))) == NULL) {
+    free(c);
+    return NULL;
+  }
+  c->fd = fd;
+  c->addr = *addr;
+  c->reactor = r;
+  c->refs = 1;
+  pthread_mutex_init(&c->out_lock, NULL);
+
+  /* edge triggered => read until EAGAIN on every wakeup */
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+  ev.data.fd = fd;
+  if (epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+    pthread_mutex_destroy(&c->out_lock);
+    thread_pool_flow_destroy(c->flow);
+    free(c);
+    return NULL;
+  }
+
+  r->conn[fd] = c;
+  r->conn_count++;
+  metrics_gauge_add(metrics, METRIC_CONNECTIONS, 1);
+
+  return c;
+}
+
+/** @internal close and forget a connection
+ *
+ */
+static void reactor_close(reactor_t *r, conn_t *c)
+{
+  /* Somebody disconnected , get his details and print */
+  printf("<< Host disconnected , ip %s , port %d \n" ,
+         inet_ntoa(c->addr.sin_addr) , ntohs(c->addr.sin_port));
+
+  /* send to log tast */
+  log_event(r->log, LOG_CLOSE_CON, &c->addr);
+
+  /* late replies of running jobs are dropped from now on, range
+     scans of a vanished coordinator stop */
+  pthread_mutex_lock(&c->out_lock);
+  c->closed = 1;
+  pthread_mutex_unlock(&c->out_lock);
+  conn_cancel(c, TRUE, 0);
+  reactor_body_drop(r, c);
+
+  /* a lost worker, its ranges go to the others */
+  if (c->cluster_peer) {
+    cluster_worker_remove(cluster, c);
+    c->cluster_peer = 0;
+    conn_put(c);
+  }
+
+  /* close removes the fd from the epoll set */
+  close(c->fd);
+  r->conn[c->fd] = NULL;
+  r->conn_count--;
+  metrics_gauge_add(metrics, METRIC_CONNECTIONS, -1);
+  conn_put(c);
+}
+
+/** @internal enable or disable EPOLLOUT for c
+ *
+ */
+static void conn_want_write(reactor_t *r, conn_t *c, int on)
+{
+  struct epoll_event ev;
+
+  if (c->want_write == on) {
+    return;
+  }
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (on ? EPOLLOUT : 0);
+  ev.data.fd = c->fd;
+  if (epoll_ctl(r->epfd, EPOLL_CTL_MOD, c->fd, &ev) < 0) {
+    perror("epoll_ctl");
+    return;
+  }
+  c->want_write = on;
+}
+
+/** @internal write queued output of c until done or EAGAIN
+ *
+ *  Up to MAX_IOV responses go out with one writev(). The queue is only
+ *  locked to collect and to consume chunks, workers keep appending
+ *  while the reactor writes.
+ */
+static void conn_flush(reactor_t *r, conn_t *c)
+{
+  struct iovec iov[MAX_IOV];
+  out_chunk_t *o;
+  ssize_t sent;
+  size_t take;
+  int cnt;
+
+  while (1) {
+    pthread_mutex_lock(&c->out_lock);
+    for (cnt = 0, o = c->out_head; o != NULL && cnt < MAX_IOV;
+         o = o->next, cnt++) {
+      iov[cnt].iov_base = o->data + o->off;
+      iov[cnt].iov_len = o->len - o->off;
+    }
+    pthread_mutex_unlock(&c->out_lock);
+    if (cnt == 0) {
+      break;
+    }
+
+    sent = writev(c->fd, iov, cnt);
+    if (sent < 0 && errno == EINTR) {
+      continue;
+    }
+    if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      /* socket full => continue on EPOLLOUT */
+      conn_want_write(r, c, 1);
+      return;
+    }
+
+    if (sent > 0) {
+      metrics_add(metrics, METRIC_BYTES_OUT, (uint64_t)sent);
+    }
+    pthread_mutex_lock(&c->out_lock);
+    if (sent < 0) {
+      /* peer gone, drop the output, reading detects the close */
+      while ((o = c->out_head) != NULL) {
+        c->out_head = o->next;
+        free(o);
+      }
+      c->out_tail = NULL;
+      c->out_bytes = 0;
+    }
+    while (sent > 0) {
+      o = c->out_head;
+      take = o->len - o->off;
+      if ((size_t)sent < take) {
+        take = (size_t)sent;
+      }
+      o->off += take;
+      sent -= (ssize_t)take;
+      if (o->off == o->len) {
+        c->out_head = o->next;
+        if (c->out_head == NULL) {
+          c->out_tail = NULL;
+        }
+        c->out_bytes -= o->len;
+        metrics_record(metrics, METRIC_SEND, metrics_now() - o->queued);
+        free(o);
+      }
+    }
+    pthread_mutex_unlock(&c->out_lock);
+  }
+
+  conn_want_write(r, c, 0);
+}
+
+/** @internal accept all pending connections
+ *
+ */
+static void reactor_accept(reactor_t *r)
+{
+  char *message = "ACK\r\n";
+  struct sockaddr_in addr;
+  socklen_t addrlen;
+  conn_t *c;
+  int fd;
+
+  while (1) {
+    addrlen = sizeof(addr);
+    fd = accept4(r->listen_fd, (struct sockaddr *)&addr, &addrlen,
+                 SOCK_NONBLOCK);
+    if (fd < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR &&
+          errno != ECONNABORTED) {
+        perror("accept");
+      }
+      /* EMFILE etc. => retry on the next wakeup */
+      return;
+    }
+
+    if ((c = reactor_add(r, fd, &addr)) == NULL) {
+      perror("Error to register connection");
+      close(fd);
+      continue;
+    }
+    __atomic_fetch_add(&r->accepted, 1, __ATOMIC_RELAXED);
+
+    /* inform user about new connection */
+    printf("<< New connection , socket fd is %d , ip is : %s , port : %d \n",
+           fd , inet_ntoa(addr.sin_addr) , ntohs(addr.sin_port));
+
+    /* send to log tast */
+    log_event(r->log, LOG_OPEN_CON, &addr);
+
+    /* send ACK to new connection */
+    if (conn_append(c, message, strlen(message), NULL, 0) == 0) {
+      conn_flush(r, c);
+    }
+  }
+}
+
+/** @internal hash all strings of a CRACK_BATCH payload
+ *
+ *  @retrun allocated array of *count crcs, NULL => malformed payload
+ */
+static uint32_t *batch_parse(const uint8_t *payload, uint32_t len,
+                             uint32_t *count)
+{
+  uint32_t *crcs;
+  uint32_t i, n, item;
+  size_t off = 4;
+
+  if (len < 4 || (n = proto_get_u32(payload)) == 0 ||
+      n > PROTO_MAX_BATCH || n > (len - 4) / 4) {
+    return NULL;
+  }
+  if ((crcs = malloc(n * sizeof(uint32_t))) == NULL) {
+    return NULL;
+  }
+
+  for (i = 0; i < n; i++) {
+    if (len - off < 4 || (item = proto_get_u32(payload + off)) >
+        len - off - 4) {
+      free(crcs);
+      return NULL;
+    }
+    crcs[i] = crc32(payload + off + 4, item);
+    off += 4 + item;
+  }
+
+  *count = n;
+
+  return crcs;
+}
+
+/** @internal check a CRACK_STRING payload
+ *
+ *  @retrun allocated alphabet string, NULL => malformed payload;
+ *          *offset receives the start of the string to crack
+ */
+static char *string_parse(const uint8_t *payload, uint32_t len,
+                          uint32_t *length, uint32_t *offset)
+{
+  char *alphabet;
+  uint32_t n;
+
+  if (len < 8 || (*length = proto_get_u32(payload)) == 0 ||
+      *length > CRACK_MITM_MAX_LEN ||
+      (n = proto_get_u32(payload + 4)) == 0 || n > len - 8 ||
+      memchr(payload + 8, '\0', n) != NULL) {
+    return NULL;
+  }
+  if ((alphabet = malloc(n + 1)) == NULL) {
+    return NULL;
+  }
+  memcpy(alphabet, payload + 8, n);
+  alphabet[n] = '\0';
+  *offset = 8 + n;
+
+  return alphabet;
+}
+
+/** @internal metrics report plus pool and cache state
+ *
+ *  @retrun length of the text (as snprintf)
+ */
+static size_t stats_report(thread_pool_t *pool,
+                           const metrics_snapshot_t *prev,
+                           metrics_snapshot_t *snap, char *buf,
+                           size_t cap)
+{
+  uint64_t hits, misses;
+  size_t len;
+
+  metrics_snapshot(metrics, snap);
+  len = metrics_format(snap, prev, buf, cap);
+
+  result_cache_stats(cache, &hits, &misses);
+  len += (size_t)snprintf(buf + (len < cap ? len : cap),
+                          len < cap ? cap - len : 0,
+                          "workers %d, queued %zu, cache %"PRIu64" hits"
+                          " %"PRIu64" misses (%.1f%%)\n",
+                          thread_pool_workers(pool),
+                          thread_pool_pending(pool), hits, misses,
+                          hits + misses ?
+                          100.0 * hits / (hits + misses) : 0.0);
+
+  return len;
+}
+
+/** @internal handle one complete request frame
+ *
+ *  @retrun 0 => ok, -1 => close the connection
+ */
+static int reactor_dispatch(reactor_t *r, conn_t *c,
+                            const proto_hdr_t *hdr,
+                            const uint8_t *payload)
+{
+  thread_job_t *job;
+  uint32_t *batch = NULL;
+  uint32_t count = 0, length = 0, offset = 0, plen = hdr->len;
+  uint64_t deadline = 0, body = 0;
+  char *alphabet = NULL;
+  metrics_snapshot_t snap;
+  char report[STATS_BUF];
+  size_t len;
+
+  /* frames of a registered worker are answers to our ranges */
+  if (c->cluster_peer) {
+    if (cluster_reply(cluster, c, hdr->id, hdr->type, payload,
+                      hdr->len) != 0) {
+      fprintf(stderr, "Worker %s reported a wrong match\n",
+              inet_ntoa(c->addr.sin_addr));
+      return -1;
+    }
+    return 0;
+  }
 
-  time ( &rawtime );
-  timeinfo = localtime(&rawtime);
-  time_str = asctime(timeinfo);
+  /* the coordinator refused our registration */
+  if (c->coordinator && hdr->type == PROTO_ERROR) {
+    fprintf(stderr, "Coordinator refused: %.*s\n", (int)hdr->len,
+            (const char *)payload);
+    return -1;
+  }
+
+  __atomic_fetch_add(&r->requests, 1, __ATOMIC_RELAXED);
+  metrics_add(metrics, METRIC_REQUESTS, 1);
+
+  /* the timeout runs from now, queue wait included */
+  if (hdr->flags & PROTO_FLAG_DEADLINE) {
+    if (plen < 4) {
+      conn_queue_text(c, PROTO_ERROR, hdr->id, "malformed deadline");
+      return 0;
+    }
+    deadline = metrics_now() + proto_get_u32(payload) * 1000000ull;
+    payload += 4;
+    plen -= 4;
+  }
+
+  if (hdr->type == PROTO_REGISTER) {
+    if (!peer_allowed(&c->addr)) {
+      conn_queue_text(c, PROTO_ERROR, hdr->id, "registration not allowed");
+      return 0;
+    }
+    /* the cluster keeps a reference until reactor_close() */
+    c->cluster_peer = 1;
+    conn_get(c);
+    log_event(r->log, LOG_JOIN_CON, &c->addr);
+    cluster_worker_add(cluster, c);
+    return 0;
+  } else if (hdr->type == PROTO_CANCEL) {
+    conn_cancel(c, FALSE, hdr->id);
+    return 0;
+  } else if (hdr->type == PROTO_CRACK_RANGE) {
+    if (plen != 12 ||
+        proto_get_u32(payload + 4) > proto_get_u32(payload + 8)) {
+      conn_queue_text(c, PROTO_ERROR, hdr->id, "malformed range");
+      return 0;
+    }
+  } else if (hdr->type == PROTO_CRACK_STRING) {
+    if ((alphabet = string_parse(payload, plen, &length,
+                                 &offset)) == NULL) {
+      conn_queue_text(c, PROTO_ERROR, hdr->id, "malformed request");
+      return 0;
+    }
+  } else if (hdr->type == PROTO_CRACK_STREAM) {
+    if (plen != 8) {
+      conn_queue_text(c, PROTO_ERROR, hdr->id, "malformed stream");
+      return 0;
+    }
+    body = (uint64_t)proto_get_u32(payload) << 32 |
+           proto_get_u32(payload + 4);
+  } else if (hdr->type == PROTO_STATS) {
+    /* cheap enough to answer right here */
+    len = stats_report(r->pool, NULL, &snap, report, sizeof(report));
+    conn_queue(c, PROTO_STATS_RESULT, hdr->id, report,
+               len < sizeof(report) ? len : sizeof(report) - 1);
+    return 0;
+  } else if (hdr->type == PROTO_CRACK_BATCH) {
+    if ((batch = batch_parse(payload, plen, &count)) == NULL) {
+      conn_queue_text(c, PROTO_ERROR, hdr->id, "malformed batch");
+      return 0;
+    }
+    metrics_add(metrics, METRIC_BATCH_ITEMS, count);
+  } else if (hdr->type != PROTO_CRACK) {
+    conn_queue_text(c, PROTO_ERROR, hdr->id, "unknown request");
+    return 0;
+  }
 
-  /* replace /n with /0 */
-  if ((pos=strchr(time_str, '\n')) != NULL) {
-    *pos = '\0';
+  /* all jobs in use or this client holds its share => let it retry
+     later; a stream takes its job before the body, so it is not sent
+     in vain */
+  if((job = thread_pool_job_get_flow(r->pool, c->flow)) == NULL) {
+    conn_queue_text(c, PROTO_BUSY, hdr->id, NULL);
+    c->body_left = body;
+    free(batch);
+    free(alphabet);
+    return 0;
   }
+  /* hash in place and queue the job for the workers */
+  job->range = (hdr->type == PROTO_CRACK_RANGE);
+  if (job->range) {
+    job->crc = proto_get_u32(payload);
+    job->first = proto_get_u32(payload + 4);
+    job->last = proto_get_u32(payload + 8);
+  } else if (hdr->type == PROTO_CRACK_STREAM) {
+    job->crc = CRC32_INIT;
+  } else if (alphabet != NULL) {
+    job->crc = crc32(payload + offset, plen - offset);
+  } else {
+    job->crc = batch ? 0 : crc32(payload, plen);
+  }
+  job->alphabet = alphabet;
+  job->length = length;
+  job->batch = batch;
+  job->count = count;
+  job->id = hdr->id;
+  job->deadline = deadline;
+  job->conn = c;
+  conn_get(c);
+  job->active = 1;
+  pthread_mutex_lock(&c->out_lock);
+  job->active_next = c->jobs;
+  c->jobs = job;
+  pthread_mutex_unlock(&c->out_lock);
+
+  /* the search of a stream starts once the body is hashed */
+  if (hdr->type == PROTO_CRACK_STREAM) {
+    c->body_job = job;
+    c->body_left = body;
+    if (body > 0) {
+      return 0;
+    }
+    job->crc = crc32_final(job->crc);
+    c->body_job = NULL;
+  }
+  reactor_submit(r, job);
 
-  return time_str;
+  return 0;
 }
 
-/** @brief logging threrad
+/** @internal dispatch all complete frames in the receive buffer
  *
+ *  @retrun 0 => ok, -1 => protocol error, close the connection
  */
-void *log_thread(void *ptr)
+static int reactor_parse(reactor_t *r, conn_t *c)
 {
+  thread_job_t *job;
+  proto_hdr_t hdr;
+  size_t off = 0, n;
 
-  FILE *fp = NULL;
-  char *pfilename = (char *)ptr;
-  log_msg_t data;
-  int terminate = 0;
-
-  /* open/create log file */
-  fp = fopen(pfilename, "w+");
-  free(pfilename);
+  while (1) {
+    /* stream body, hashed as it arrives; the body of a stream that
+       got BUSY is skipped */
+    if (c->body_left > 0) {
+      n = c->in_len - off;
+      n = n < c->body_left ? n : (size_t)c->body_left;
+      if ((job = c->body_job) != NULL) {
+        job->crc = crc32_update(job->crc, c->in + off, n);
+      }
+      off += n;
+      if ((c->body_left -= n) > 0) {
+        break;
+      }
+      if (job != NULL) {
+        job->crc = crc32_final(job->crc);
+        c->body_job = NULL;
+        reactor_submit(r, job);
+      }
+    }
 
-  /* create message queue */
-  long int msqid = msgget(MQ_KEY, 0);
-  if (msqid < 0) {
-    perror("msgget");
-    return NULL;
+    if (c->in_len - off < PROTO_HDR_LEN) {
+      break;
+    }
+    proto_unpack_hdr(c->in + off, &hdr);
+    if (hdr.len > PROTO_MAX_PAYLOAD) {
+      conn_queue_text(c, PROTO_ERROR, hdr.id, "frame too large");
+      conn_flush(r, c);
+      return -1;
+    }
+    if (c->in_len - off < PROTO_HDR_LEN + hdr.len) {
+      break;
+    }
+    if (reactor_dispatch(r, c, &hdr, c->in + off + PROTO_HDR_LEN) < 0) {
+      return -1;
+    }
+    off += PROTO_HDR_LEN + hdr.len;
   }
 
-  /* print start log message */
-  fprintf(fp, "%s           *** Server starts successfully ***\n",
-          get_local_time());
-  fflush(fp);
+  /* keep the incomplete rest at the start of the buffer */
+  memmove(c->in, c->in + off, c->in_len - off);
+  c->in_len -= off;
 
-  while(1) {
-    if(msgrcv(msqid, &data, sizeof(data), 0, 0) > 0) {
-      switch(data.type) {
-      case MQ_TYPE_OPEN_CON:
-        fprintf(fp, "%s           Client connected on port number: %s\n",
-                get_local_time(), data.port);
-        break;
-      case MQ_TYPE_CLOSE_CON:
-        fprintf(fp, "%s           Client diconnected on port number: %s\n",
-                get_local_time(), data.port);
-        break;
-      case MQ_TYPE_TERMINATE:
-        terminate = 1;
-        fprintf(fp, "%s           *** Server shut down properly ***\n",
-                get_local_time());
-        break;
+  return 0;
+}
+
+/** @internal read everything available and dispatch complete frames
+ *
+ *  Replies queued by the reactor itself are flushed once at the end.
+ *  A client that does not read its responses is not read from either
+ *  until its output drained below OUT_BUF_MAX.
+ */
+static void reactor_read(reactor_t *r, conn_t *c)
+{
+  ssize_t valread;
+  uint8_t *in;
+
+  while (1) {
+    if (conn_pending(c) > OUT_BUF_MAX) {
+      conn_flush(r, c);
+      if (conn_pending(c) > OUT_BUF_MAX) {
+        c->read_paused = 1;
+        return;
       }
-      fflush(fp);
     }
 
-    if(terminate) {
+    /* room for at least READ_BUF more bytes */
+    if (c->in_cap - c->in_len < READ_BUF) {
+      in = realloc(c->in, c->in_len + READ_BUF);
+      if (in == NULL) {
+        perror("realloc");
+        reactor_close(r, c);
+        return;
+      }
+      c->in = in;
+      c->in_cap = c->in_len + READ_BUF;
+    }
+
+    valread = read(c->fd, c->in + c->in_len, c->in_cap - c->in_len);
+    if (valread < 0 && errno == EINTR) {
+      continue;
+    }
+    if (valread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
       break;
     }
+    if (valread <= 0) {
+      reactor_close(r, c);
+      return;
+    }
 
-    msqid = msgget(MQ_KEY, 0);
-    if (msqid < 0) {
-      perror("msgget");
+    c->in_len += (size_t)valread;
+    metrics_add(metrics, METRIC_BYTES_IN, (uint64_t)valread);
+    if (reactor_parse(r, c) < 0) {
+      reactor_close(r, c);
+      return;
     }
+  }
 
+  /* give large buffers back once they are drained */
+  if (c->in_len == 0 && c->in_cap > IN_BUF_KEEP) {
+    free(c->in);
+    c->in = NULL;
+    c->in_cap = 0;
   }
 
-  /* close file handler */
-  fclose(fp);
+  conn_flush(r, c);
+}
 
-  return NULL;
+/** @internal flush c and resume reading once its output drained
+ *
+ */
+static void reactor_write(reactor_t *r, conn_t *c)
+{
+  conn_flush(r, c);
+  if (c->read_paused && conn_pending(c) <= OUT_BUF_MAX) {
+    c->read_paused = 0;
+    reactor_read(r, c);
+  }
 }
 
-/** @brief crc thread
+/** @internal flush all connections workers queued replies for
  *
  */
-void *hash_cracker(void *ptr)
+static void reactor_flush_ready(reactor_t *r)
 {
+  conn_t *list, *c;
 
-  thread_job_t *job = (thread_job_t *)ptr;
-  uint32_t orig_crc = crc32(job->data, job->len);
-  char result[1024];
-  uint32_t cur_crc = 0;
-  uint32_t i = 0;
+  pthread_mutex_lock(&r->ready_lock);
+  list = r->ready;
+  r->ready = NULL;
+  pthread_mutex_unlock(&r->ready_lock);
 
+  while ((c = list) != NULL) {
+    list = c->ready_next;
 
-  /* search for equal hash code */
-  while (1) {
-    uint8_t in[] = {(i>>24), (i>>16), (i>>8), i};
-    cur_crc = crc32(in, sizeof(in));
+    /* replies queued from now on schedule a new flush */
+    pthread_mutex_lock(&c->out_lock);
+    c->flush_queued = 0;
+    pthread_mutex_unlock(&c->out_lock);
 
-    if (cur_crc == orig_crc) {
-      break;
+    if (!c->closed) {
+      reactor_write(r, c);
     }
-    i++;
+    conn_put(c);
+  }
+}
 
-    /* return if ^C */
-    if(!run) {
-      return NULL;
+/** @internal event loop, returns on ^C (woken through wake_fd)
+ *
+ */
+static void reactor_run(reactor_t *r)
+{
+  struct epoll_event events[MAX_EVENTS];
+  uint64_t wakeups;
+  conn_t *c;
+  int n, i, fd;
+
+  while (run) {
+    n = epoll_wait(r->epfd, events, MAX_EVENTS, -1);
+    if (n < 0) {
+      if (errno != EINTR) {
+        perror("epoll_wait");
+      }
+      continue;
+    }
+
+    for (i = 0; i < n; i++) {
+      if (events[i].data.fd == r->listen_fd) {
+        reactor_accept(r);
+        continue;
+      }
+      if (events[i].data.fd == r->wake_fd) {
+        if (read(r->wake_fd, &wakeups, sizeof(wakeups)) < 0) {
+          /* nothing pending */
+        }
+        reactor_flush_ready(r);
+        continue;
+      }
+      fd = events[i].data.fd;
+      if ((c = r->conn[fd]) == NULL) {
+        continue;
+      }
+      if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP |
+                              EPOLLERR)) {
+        /* read also detects EOF and errors */
+        reactor_read(r, c);
+      }
+      /* reading may have closed c */
+      if ((events[i].events & EPOLLOUT) && r->conn[fd] == c) {
+        reactor_write(r, c);
+      }
     }
   }
+}
 
-  /* format result in string */
-  sprintf(result, "0x%08"PRIx32"\r\n", i);
+/** @internal reactor thread
+ *
+ */
+static void *reactor_thread(void *ptr)
+{
+  reactor_run((reactor_t *)ptr);
+
+  return NULL;
+}
+
+/** @internal add fd to the epoll set of r
+ *
+ */
+static int reactor_watch(reactor_t *r, int fd)
+{
+  struct epoll_event ev;
+
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN | EPOLLET;
+  ev.data.fd = fd;
+
+  return epoll_ctl(r->epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/** @internal create the listening socket and the epoll set
+ *
+ *  All reactors bind the same address with SO_REUSEPORT, the kernel
+ *  spreads new connections over their accept queues.
+ *
+ *  @retrun 0 => ok, -1 => error (errno set, message printed)
+ */
+static int reactor_init(reactor_t *r, int id,
+                        const struct sockaddr_in *srv, int backlog)
+{
+  int one = 1;
+
+  memset(r, 0, sizeof(*r));
+  r->id = id;
+  r->listen_fd = r->epfd = r->wake_fd = -1;
+  pthread_mutex_init(&r->ready_lock, NULL);
+
+  /* create a master socket */
+  if((r->listen_fd = socket(srv->sin_family, SOCK_STREAM , 0)) == -1) {
+    perror("Error to create socket");
+    return -1;
+  }
+  if (setsockopt(r->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one,
+                 sizeof(one)) < 0 ||
+      setsockopt(r->listen_fd, SOL_SOCKET, SO_REUSEPORT, &one,
+                 sizeof(one)) < 0) {
+    perror("setsockopt");
+    return -1;
+  }
 
-  /* send result to client */
-  if(send(job->socket_fd, result, strlen(result),
-          0) != strlen(result) ) {
-    perror("send");
+  /* bind socket */
+  if (bind(r->listen_fd, (struct sockaddr *)srv,
+           sizeof(*srv))<0) {
+    perror("bind failed");
+    return -1;
   }
 
-  return NULL;
+  /* pending connections for master_socket */
+  if (set_nonblocking(r->listen_fd) < 0 ||
+      listen(r->listen_fd, backlog) < 0) {
+    perror("listen");
+    return -1;
+  }
+
+  /* create event loop */
+  if ((r->epfd = epoll_create1(0)) < 0 ||
+      (r->wake_fd = eventfd(0, EFD_NONBLOCK)) < 0) {
+    perror("epoll_create1");
+    return -1;
+  }
+  if (reactor_watch(r, r->listen_fd) < 0 ||
+      reactor_watch(r, r->wake_fd) < 0) {
+    perror("epoll_ctl");
+    return -1;
+  }
+
+  return 0;
+}
+
+/** @internal close all connections and sockets of r
+ *
+ */
+static void reactor_cleanup(reactor_t *r)
+{
+  conn_t *c;
+  int i;
+
+  /* the workers are gone, nothing is flushed any more */
+  while ((c = r->ready) != NULL) {
+    r->ready = c->ready_next;
+    conn_put(c);
+  }
+  for(i = 0; i < r->conn_cap; i++) {
+    if((c = r->conn[i]) != NULL) {
+      close(c->fd);
+      if (c->cluster_peer) {
+        conn_put(c);
+      }
+      conn_put(c);
+    }
+  }
+  free(r->conn);
+  pthread_mutex_destroy(&r->ready_lock);
+  if (r->epfd >= 0) {
+    close(r->epfd);
+  }
+  if (r->wake_fd >= 0) {
+    close(r->wake_fd);
+  }
+  if (r->listen_fd >= 0) {
+    close(r->listen_fd);
+  }
+}
+
+/** @internal raise the open file limit to the hard limit
+ *
+ */
+static void raise_fd_limit(void)
+{
+  struct rlimit rl;
+
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+  }
+}
+
+/** @internal join the coordinator at "IP:port" as a worker
+ *
+ *  The greeting is read and REGISTER sent before the connection goes
+ *  to the reactor, from then on the coordinator is served like any
+ *  client whose requests are CRACK_RANGE and CANCEL.
+ *
+ *  @retrun 0 => ok, -1 => error (message printed)
+ */
+static int cluster_join(reactor_t *r, const char *coordinator)
+{
+  struct sockaddr_in addr;
+  uint8_t buf[PROTO_HDR_LEN];
+  char ip[INET_ADDRSTRLEN];
+  proto_hdr_t hdr;
+  const char *colon;
+  size_t got = 0;
+  ssize_t n;
+  conn_t *c;
+  int fd;
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  if ((colon = strrchr(coordinator, ':')) == NULL ||
+      (size_t)(colon - coordinator) >= sizeof(ip)) {
+    fprintf(stderr, "Coordinator must be IP:port\n");
+    return -1;
+  }
+  memcpy(ip, coordinator, colon - coordinator);
+  ip[colon - coordinator] = '\0';
+  addr.sin_port = htons(atoi(colon + 1));
+  if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1) {
+    fprintf(stderr, "Coordinator must be IP:port\n");
+    return -1;
+  }
+
+  if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+    perror("Error to create socket");
+    return -1;
+  }
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+    perror("Error to connect coordinator");
+    close(fd);
+    return -1;
+  }
+
+  /* "ACK\r\n" */
+  while (got < 5 && (n = read(fd, buf + got, 5 - got)) > 0) {
+    got += (size_t)n;
+  }
+  if (got != 5 || memcmp(buf, "ACK\r\n", 5) != 0) {
+    fprintf(stderr, "Coordinator did not greet\n");
+    close(fd);
+    return -1;
+  }
+  memset(&hdr, 0, sizeof(hdr));
+  hdr.type = PROTO_REGISTER;
+  proto_pack_hdr(buf, &hdr);
+  if (write(fd, buf, PROTO_HDR_LEN) != PROTO_HDR_LEN ||
+      set_nonblocking(fd) < 0) {
+    perror("Error to register with coordinator");
+    close(fd);
+    return -1;
+  }
+
+  if ((c = reactor_add(r, fd, &addr)) == NULL) {
+    perror("Error to register connection");
+    close(fd);
+    return -1;
+  }
+  c->coordinator = 1;
+  log_event(r->log, LOG_JOIN_CON, &addr);
+
+  return 0;
+}
+
+/** @internal write the metrics report to the log, one record per
+ *            line
+ *
+ */
+static void stats_log(async_log_t *log, thread_pool_t *pool,
+                      metrics_snapshot_t *prev)
+{
+  metrics_snapshot_t snap;
+  char report[STATS_BUF];
+  char *line, *save = NULL;
+
+  stats_report(pool, prev, &snap, report, sizeof(report));
+  for (line = strtok_r(report, "\n", &save); line != NULL;
+       line = strtok_r(NULL, "\n", &save)) {
+    async_log_printf(log, "stats: %s", line);
+  }
+  *prev = snap;
+}
+
+/** @internal parse a -W IP=weight argument
+ *
+ *  @retrun 0 => ok, -1 => malformed or too many
+ */
+static int weight_parse(const char *arg)
+{
+  char ip[INET_ADDRSTRLEN];
+  const char *eq;
+  int weight;
+
+  if ((eq = strchr(arg, '=')) == NULL || eq - arg >= (long)sizeof(ip) ||
+      weight_count == MAX_WEIGHTS) {
+    return -1;
+  }
+  memcpy(ip, arg, eq - arg);
+  ip[eq - arg] = '\0';
+  if (inet_pton(AF_INET, ip, &weight_addr[weight_count]) != 1 ||
+      (weight = atoi(eq + 1)) < 1) {
+    return -1;
+  }
+  weight_value[weight_count++] = weight;
+
+  return 0;
+}
+
+/** @internal parse a -A IP argument
+ *
+ *  @retrun 0 => ok, -1 => malformed or too many
+ */
+static int peer_parse(const char *arg)
+{
+  if (peer_count == MAX_PEERS ||
+      inet_pton(AF_INET, arg, &peer_addr[peer_count]) != 1) {
+    return -1;
+  }
+  peer_count++;
+
+  return 0;
 }
 
 /** @internal print usage of program
@@ -209,7 +1720,15 @@ static void print_usage(void)
 {
   printf("\n  Hash cracker server 1.0\n  Maintained by: Fränz Ney\n\n");
   printf("\nUsage:\n------\n");
-  printf("          hash_server [-i IP] [-p port] [-l logfile] [-h]\n\n");
+  printf("          hash_server [-i IP] [-p port] [-l logfile]\n"
+         "                      [-m solve|brute|simd|gray] [-t threads]"
+         " [-c cache size]\n"
+         "                      [-w workers] [-q queue length]"
+         " [-b backlog]\n"
+         "                      [-r reactors] [-s stats interval]"
+         " [-j coordinator IP:port]\n"
+         "                      [-A worker IP] [-f] [-M table MB]"
+         " [-W IP=weight] [-h]\n\n");
 }
 
 /** @brief ctrc handler
@@ -226,27 +1745,35 @@ void cntrl_c_handler(int ignored)
  */
 int main(int argc , char *argv[])
 {
-  int master_socket , addrlen , new_socket , client_socket[30] ,
-      max_clients = 30 , activity, i , valread , sd;
-  int max_sd;
+  int i;
   int option = 0;
   int iflag = 0, pflag = 0, lflag = 0;
-  pthread_t thread[30];
-  pthread_t thread_log;
-  thread_job_t job[30];
+  async_log_t *log;
+  thread_pool_t *pool;
+  reactor_t *reactor;
+  int reactors = DEFAULT_REACTORS;
+  sigset_t sigint, oldmask;
+  int workers = 0;
+  int backlog = DEFAULT_BACKLOG;
+  long queue_len = DEFAULT_QUEUE_LEN;
   struct sockaddr_in srv;
-  char buffer[1025];  //data buffer of 1K
-  fd_set readfds;
-  char *message = "ACK\r\n";
   char *pfilename = NULL;
-  log_msg_t data;
-  long int msqid;
+  long cache_size = DEFAULT_CACHE_SIZE;
+  uint64_t cache_hits, cache_misses;
+  int stats_interval = DEFAULT_STATS_INTERVAL;
+  metrics_snapshot_t stats_prev;
+  struct timespec stats_ts;
+  char *coordinator = NULL;
+  cluster_mode_t cluster_mode = CLUSTER_LOWEST;
+  conn_t *c;
+  int k;
 
   /* fill srv with null */
   memset(&srv, 0, sizeof(struct sockaddr_in));
 
   /* decode arguments */
-  while ((option = getopt(argc, argv,"i:p:l:h")) != -1) {
+  while ((option = getopt(argc, argv,
+                          "i:p:l:m:t:c:w:q:b:r:s:j:A:fM:W:h")) != -1) {
     switch (option) {
     case 'i' :
       if(inet_pton(AF_INET, optarg, &srv.sin_addr)) {
@@ -274,6 +1801,77 @@ int main(int argc , char *argv[])
       strcat(pfilename, ".txt");
       lflag = 1;
       break;
+    case 'm':
+      if (crack_engine_parse(optarg, &crack_opts.engine) != 0) {
+        errno = EINVAL;
+        perror("Unknown search engine");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 't':
+      crack_opts.threads = atoi(optarg);
+      break;
+    case 'c':
+      cache_size = atol(optarg);
+      if (cache_size < 0) {
+        errno = EINVAL;
+        perror("Invalid cache size");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'w':
+      workers = atoi(optarg);
+      break;
+    case 'q':
+      queue_len = atol(optarg);
+      if (queue_len < 0) {
+        errno = EINVAL;
+        perror("Invalid queue length");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'b':
+      backlog = atoi(optarg);
+      break;
+    case 'r':
+      reactors = atoi(optarg);
+      if (reactors < 1) {
+        errno = EINVAL;
+        perror("Invalid number of reactors");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 's':
+      stats_interval = atoi(optarg);
+      break;
+    case 'j':
+      coordinator = optarg;
+      break;
+    case 'A':
+      if (peer_parse(optarg) != 0) {
+        errno = EINVAL;
+        perror("Invalid worker address");
+        exit(EXIT_FAILURE);
+      }
+      break;
+    case 'f':
+      cluster_mode = CLUSTER_FIRST;
+      break;
+    case 'M':
+      if (atol(optarg) <= 0) {
+        errno = EINVAL;
+        perror("Invalid table memory");
+        exit(EXIT_FAILURE);
+      }
+      mitm_memory = (size_t)atol(optarg) << 20;
+      break;
+    case 'W':
+      if (weight_parse(optarg) != 0) {
+        errno = EINVAL;
+        perror("Invalid client weight");
+        exit(EXIT_FAILURE);
+      }
+      break;
     case 'h' :
       print_usage();
       exit(EXIT_FAILURE);
@@ -284,8 +1882,14 @@ int main(int argc , char *argv[])
     }
   }
 
-  /* catch cntrl_c signal */
+  /* catch cntrl_c signal, only the main thread takes it => block it
+     here, every thread started from now on inherits the mask */
   signal(SIGINT, cntrl_c_handler);
+  /* a vanished client => EPIPE from writev() instead of a signal */
+  signal(SIGPIPE, SIG_IGN);
+  sigemptyset(&sigint);
+  sigaddset(&sigint, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &sigint, &oldmask);
 
   /* use default ipv4 address */
   if(iflag == 0) {
@@ -302,184 +1906,142 @@ int main(int argc , char *argv[])
     strcpy(pfilename, "logfile.txt");
   }
 
-  /* create message queue */
-  msqid = msgget(MQ_KEY, IPC_CREAT | S_IRWXU | S_IROTH);
-  if (msqid < 0) {
-    perror("msgget");
-    return 1;
-  }
-
-  /* initialise all client_socket[] to 0 so not checked */
-  for (i = 0; i < max_clients; i++) {
-    client_socket[i] = 0;
+  /* counters and latency histograms of all threads */
+  if ((metrics = metrics_create()) == NULL) {
+    perror("Error to create metrics");
+    exit(EXIT_FAILURE);
   }
+  memset(&stats_prev, 0, sizeof(stats_prev));
 
-  /* create a master socket */
-  if((master_socket = socket(srv.sin_family, SOCK_STREAM , 0)) == -1) {
-    perror("Error to create socket");
+  /* create result cache, size 0 disables it */
+  cache = result_cache_create((size_t)cache_size);
+  if (cache == NULL && cache_size > 0) {
+    perror("Error to create result cache");
     exit(EXIT_FAILURE);
   }
 
-  /* start log thread */
-  if((pthread_create(&thread_log, NULL, log_thread,
-                     (void *)pfilename)) != 0) {
-    perror("Error to create log thread");
+  /* registered workers take over brute force searches */
+  if ((cluster = cluster_create(cluster_mode, DEFAULT_CLUSTER_DEPTH,
+                                cluster_send)) == NULL) {
+    perror("Error to create cluster");
     exit(EXIT_FAILURE);
-  };
+  }
 
-  /* bind socket */
-  if (bind(master_socket, (struct sockaddr *)&srv,
-           sizeof(srv))<0) {
-    perror("bind failed");
+  /* start worker pool, workers 0 => one per core */
+  pool = thread_pool_create(workers, (size_t)queue_len,
+                            sizeof(thread_job_t), hash_cracker);
+  if (pool == NULL) {
+    perror("Error to create worker pool");
     exit(EXIT_FAILURE);
   }
 
-  printf("*** Hash cracker server is ready ***\n\n");
+  /* one fd per connection, allow as many as we may */
+  raise_fd_limit();
 
-  /* max 3 pending connections for master_socket */
-  if (listen(master_socket, 3) < 0) {
-    perror("listen");
+  /* start log thread, a full log drops records instead of stalling
+     the reactors */
+  if ((log = async_log_open(pfilename, DEFAULT_LOG_RECORDS,
+                            ASYNC_LOG_DROP)) == NULL) {
+    perror("Error to open log file");
     exit(EXIT_FAILURE);
   }
+  free(pfilename);
+  async_log_printf(log, "*** Server starts successfully ***");
 
-  /* accept the incoming connection */
-  addrlen = sizeof(srv);
-  puts(">> Waiting for connections ...");
-
-  while(run) {
-    /* clear the socket set */
-    FD_ZERO(&readfds);
-
-    /* add master socket to set */
-    FD_SET(master_socket, &readfds);
-    max_sd = master_socket;
+  /* create the reactors, each with its own listening socket */
+  if ((reactor = calloc(reactors, sizeof(reactor_t))) == NULL) {
+    perror("calloc");
+    exit(EXIT_FAILURE);
+  }
+  for (i = 0; i < reactors; i++) {
+    if (reactor_init(&reactor[i], i, &srv, backlog) < 0) {
+      exit(EXIT_FAILURE);
+    }
+    reactor[i].pool = pool;
+    reactor[i].log = log;
+  }
 
-    /* add child sockets to set */
-    for ( i = 0 ; i < max_clients ; i++) {
-      /* socket descriptor */
-      sd = client_socket[i];
+  /* work for a coordinator, served by the first reactor */
+  if (coordinator != NULL && cluster_join(&reactor[0], coordinator) < 0) {
+    exit(EXIT_FAILURE);
+  }
 
-      /* if valid socket descriptor then add to read list */
-      if(sd > 0) {
-        FD_SET( sd , &readfds);
-      }
+  printf("*** Hash cracker server is ready ***\n\n");
 
-      /* get highest file desciptor => need for select() */
-      if(sd > max_sd) {
-        max_sd = sd;
-      }
+  for (i = 0; i < reactors; i++) {
+    if (pthread_create(&reactor[i].thread, NULL, reactor_thread,
+                       &reactor[i]) != 0) {
+      perror("Error to create reactor thread");
+      exit(EXIT_FAILURE);
     }
+  }
 
-    /* wait for an activity on one of the sockets */
-    activity = select(max_sd + 1, &readfds, NULL, NULL, NULL);
+  /* accept the incoming connection */
+  puts(">> Waiting for connections ...");
 
-    if(activity <= 0) {
+  /* wait for ^C, dump the metrics every stats_interval seconds */
+  while (run) {
+    if (stats_interval <= 0) {
+      sigsuspend(&oldmask);
       continue;
     }
-
-    if((activity < 0) && (errno != EINTR)) {
-      printf("select error");
-      continue;
+    stats_ts.tv_sec = stats_interval;
+    stats_ts.tv_nsec = 0;
+    if (pselect(0, NULL, NULL, NULL, &stats_ts, &oldmask) == 0) {
+      stats_log(log, pool, &stats_prev);
     }
+  }
 
-    /* incomming connection on master_sockets */
-    if(FD_ISSET(master_socket, &readfds)) {
-      if((new_socket = accept(master_socket, (struct sockaddr *)&srv,
-                              (socklen_t*)&addrlen)) < 0) {
-        perror("accept");
-        exit(EXIT_FAILURE);
-      }
-
-      /* inform user about new connection */
-      printf("<< New connection , socket fd is %d , ip is : %s , port : %d \n",
-             new_socket , inet_ntoa(srv.sin_addr) , ntohs(srv.sin_port));
-
-      /* send to log tast */
-      data.type = MQ_TYPE_OPEN_CON;
-      sprintf(data.port, "%d", ntohs(srv.sin_port));
-      if (msgsnd(msqid, &data, sizeof(data), 0) < 0) {
-        perror("msgsnd");
-        exit(EXIT_FAILURE);
-      }
-
-      /* send ACK to new connection */
-      if( send(new_socket, message, strlen(message),
-               0) != strlen(message) ) {
-        perror("send");
-      }
+  /* stop the reactors */
+  for (i = 0; i < reactors; i++) {
+    reactor_wake(&reactor[i]);
+  }
+  for (i = 0; i < reactors; i++) {
+    pthread_join(reactor[i].thread, NULL);
+  }
 
-      /* add new socket to array of sockets */
-      for (i = 0; i < max_clients; i++) {
-        /* if position is empty */
-        if( client_socket[i] == 0 ) {
-          client_socket[i] = new_socket;
-          break;
-        }
-      }
-    }
-    /* incomming connection on other socket */
-    for(i = 0; i < max_clients; i++) {
-      sd = client_socket[i];
-      if(FD_ISSET(sd, &readfds)) {
-        //Check if it was for closing , and also read the incoming message
-        if((valread = read(sd, buffer, 1024)) == 0) {
-          /* Somebody disconnected , get his details and print */
-          getpeername(sd , (struct sockaddr*)&srv , (socklen_t*)&addrlen);
-          printf("<< Host disconnected , ip %s , port %d \n" ,
-                 inet_ntoa(srv.sin_addr) ,
-                 ntohs(srv.sin_port));
-
-          /* send to log tast */
-          data.type = MQ_TYPE_CLOSE_CON;
-          sprintf(data.port, "%d", ntohs(srv.sin_port));
-          if (msgsnd(msqid, &data, sizeof(data), 0) < 0) {
-            perror("msgsnd");
-            exit(EXIT_FAILURE);
-          }
-          /* Close the socket and mark as 0 in list for reuse */
-          close(sd);
-          client_socket[i] = 0;
-        } else {
-          /* copy data to job */
-          memcpy(job[i].data, buffer, valread);
-          job[i].socket_fd = sd;
-          job[i].len = valread;
-          if((pthread_create(&thread[i], NULL, hash_cracker,
-                             (void *)&job[i])) != 0) {
-            perror("Error to create hash_cracker thread");
-            exit(EXIT_FAILURE);
-          }
-        }
+  /* wait for the workers, running and queued searches abort on their
+     cancel flag and drop their connection reference, the jobs of
+     half received streams are given back */
+  for (i = 0; i < reactors; i++) {
+    for (k = 0; k < reactor[i].conn_cap; k++) {
+      if ((c = reactor[i].conn[k]) != NULL) {
+        conn_cancel(c, TRUE, 0);
+        reactor_body_drop(&reactor[i], c);
       }
     }
   }
+  stats_log(log, pool, &stats_prev);
+  thread_pool_destroy(pool);
 
   /* close all open connections */
-  for(i = 0; i < max_clients; i++) {
-    sd = client_socket[i];
-    if(sd != 0) {
-      close(sd);
-    }
+  printf("\r  \n");
+  for (i = 0; i < reactors; i++) {
+    printf(">> Reactor %d: %"PRIu64" connections, %"PRIu64" requests\n",
+           i, reactor[i].accepted, reactor[i].requests);
+    reactor_cleanup(&reactor[i]);
   }
-  /* terminate log thread */
-  data.type = MQ_TYPE_TERMINATE;
-  sprintf(data.port, "%d", ntohs(srv.sin_port));
-  if (msgsnd(msqid, &data, sizeof(data), 0) < 0) {
-    perror("msgsnd");
-    exit(EXIT_FAILURE);
-  }
-  /* wait for log thread */
-  pthread_join(thread_log, NULL);
+  free(reactor);
 
-  /* wait for all hasch crack threads */
-  for(i = 0; i < max_clients; i++) {
-    sd = client_socket[i];
-    if(sd != 0) {
-      pthread_join(thread[i], NULL);
-    }
+  /* terminate log thread, it writes what is still queued */
+  async_log_printf(log, "*** Server shut down properly ***");
+  if (async_log_dropped(log) > 0) {
+    printf(">> Log: %"PRIu64" records dropped\n", async_log_dropped(log));
+  }
+  async_log_close(log);
+
+  /* report cache effectiveness */
+  result_cache_stats(cache, &cache_hits, &cache_misses);
+  printf(">> Result cache: %"PRIu64" hits, %"PRIu64" misses\n",
+         cache_hits, cache_misses);
+  result_cache_destroy(cache);
+  cluster_destroy(cluster);
+  if (mitm != NULL) {
+    mitm_put(mitm);
   }
+  metrics_destroy(metrics);
 
-  printf("\r  \n*** Server closed ***\n");
+  printf("\n*** Server closed ***\n");
   return EXIT_SUCCESS;
 }
 
@@ -0,0 +1,541 @@
+/**
+ * @file load_gen.c
+ * @date 17 Oct 2026
+ * @brief Load generator of the hash cracker client (-b)
+ *
+ *        All connections are non-blocking and served by one epoll loop.
+ *        A request id selects a slot of the per connection window
+ *        which holds the time the request was due; in open loop mode
+ *        that is its scheduled time, not the time it actually went out,
+ *        so a server that stalls is charged for the whole backlog
+ *        (no coordinated omission).  A request whose window is full
+ *        waits and goes out late with its scheduled time, what is
+ *        still waiting at the end counts as infinite latency.  Only
+ *        results are timed, BUSY and errors are counted.  Latencies
+ *        are kept and sorted at the end for exact percentiles.
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#define _POSIX_C_SOURCE     200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include "protocol.h"
+#include "load_gen.h"
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define LG_WINDOW       4096      /* requests in flight per connection */
+#define LG_MAX_EVENTS   256
+#define LG_DRAIN_NS     5000000000ull
+#define LG_KEY_LEN      64
+#define LG_LATE_NS      1000000ull
+#define LG_UNSENT       UINT64_MAX  /* latency of a request never sent */
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef struct lg_conn_s {
+  int fd;
+  int index;
+  uint32_t next_id;
+  int outstanding;
+  uint64_t due[LG_WINDOW];   /* 0 => slot free */
+  uint8_t *in;
+  size_t in_len;
+  size_t in_cap;
+  uint8_t *out;
+  size_t out_len;
+  size_t out_cap;
+} lg_conn_t;
+
+typedef struct lg_stats_s {
+  uint64_t sent;
+  uint64_t ok;
+  uint64_t busy;
+  uint64_t errors;
+  uint64_t lost;
+  uint64_t late;
+  uint64_t unsent;
+  uint64_t *lat;
+  size_t lat_len;
+  size_t lat_cap;
+} lg_stats_t;
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal monotonic clock in ns
+ *
+ */
+static uint64_t lg_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/** @internal make sure buf has room for len more bytes
+ *
+ *  @retrun 0 => ok, -1 => out of memory
+ */
+static int lg_reserve(uint8_t **buf, size_t *cap, size_t used,
+                      size_t len)
+{
+  uint8_t *tmp;
+  size_t want;
+
+  if (*cap - used >= len) {
+    return 0;
+  }
+  for (want = *cap ? *cap : 4096; want - used < len; want *= 2) {
+  }
+  if ((tmp = realloc(*buf, want)) == NULL) {
+    return -1;
+  }
+  *buf = tmp;
+  *cap = want;
+
+  return 0;
+}
+
+/** @internal open one connection and wait for the ACK
+ *
+ *  @retrun socket, -1 on error
+ */
+static int lg_connect(const struct sockaddr_in *srv)
+{
+  char ack[5];
+  size_t got = 0;
+  ssize_t n;
+  int fd;
+
+  if ((fd = socket(srv->sin_family, SOCK_STREAM, 0)) < 0) {
+    return -1;
+  }
+  if (connect(fd, (const struct sockaddr *)srv, sizeof(*srv)) < 0) {
+    close(fd);
+    return -1;
+  }
+  while (got < sizeof(ack)) {
+    n = recv(fd, ack + got, sizeof(ack) - got, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close(fd);
+      return -1;
+    }
+    got += (size_t)n;
+  }
+  if (strncmp(ack, "ACK", 3) != 0 ||
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+    close(fd);
+    return -1;
+  }
+
+  return fd;
+}
+
+/** @internal close a connection, its open requests count as lost
+ *
+ */
+static void lg_close(lg_conn_t *c, lg_stats_t *st)
+{
+  if (c->fd < 0) {
+    return;
+  }
+  close(c->fd);
+  c->fd = -1;
+  st->lost += (uint64_t)c->outstanding;
+  c->outstanding = 0;
+}
+
+/** @internal write as much queued output as the socket takes
+ *
+ */
+static void lg_flush(lg_conn_t *c, lg_stats_t *st)
+{
+  size_t off = 0;
+  ssize_t n;
+
+  while (off < c->out_len) {
+    n = send(c->fd, c->out + off, c->out_len - off, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      /* rest goes out on EPOLLOUT */
+      break;
+    }
+    if (n < 0) {
+      lg_close(c, st);
+      return;
+    }
+    off += (size_t)n;
+  }
+  memmove(c->out, c->out + off, c->out_len - off);
+  c->out_len -= off;
+}
+
+/** @internal queue one CRACK request that was due at time due
+ *
+ *  @retrun 0 => queued, -1 => window slot still busy
+ */
+static int lg_request(lg_conn_t *c, const load_opts_t *opts,
+                      uint64_t seq, uint64_t due, lg_stats_t *st)
+{
+  uint8_t hdr_buf[PROTO_HDR_LEN];
+  char key[LG_KEY_LEN];
+  const char *payload;
+  proto_hdr_t hdr;
+  uint32_t slot = c->next_id % LG_WINDOW;
+  size_t len;
+
+  if (c->due[slot] != 0) {
+    return -1;
+  }
+
+  /* corpus strings round robin, or unique generated ones */
+  if (opts->corpus != NULL) {
+    payload = opts->corpus[seq % opts->corpus_len];
+  } else {
+    sprintf(key, "load-%d-%"PRIu32, c->index, c->next_id);
+    payload = key;
+  }
+  len = strlen(payload);
+
+  if (lg_reserve(&c->out, &c->out_cap, c->out_len,
+                 PROTO_HDR_LEN + len) < 0) {
+    return -1;
+  }
+  hdr.len = (uint32_t)len;
+  hdr.id = c->next_id++;
+  hdr.type = PROTO_CRACK;
+  hdr.flags = 0;
+  proto_pack_hdr(hdr_buf, &hdr);
+  memcpy(c->out + c->out_len, hdr_buf, PROTO_HDR_LEN);
+  memcpy(c->out + c->out_len + PROTO_HDR_LEN, payload, len);
+  c->out_len += PROTO_HDR_LEN + len;
+
+  c->due[slot] = due ? due : 1;
+  c->outstanding++;
+  st->sent++;
+
+  return 0;
+}
+
+/** @internal keep one latency sample
+ *
+ */
+static void lg_sample(lg_stats_t *st, uint64_t ns)
+{
+  uint64_t *lat;
+
+  if (st->lat_len == st->lat_cap) {
+    st->lat_cap = st->lat_cap ? st->lat_cap * 2 : 65536;
+    if ((lat = realloc(st->lat, st->lat_cap * sizeof(*lat))) == NULL) {
+      st->lat_cap = st->lat_len;
+    } else {
+      st->lat = lat;
+    }
+  }
+  if (st->lat_len < st->lat_cap) {
+    st->lat[st->lat_len++] = ns;
+  }
+}
+
+/** @internal read replies and account them, a fast BUSY or error is
+ *            no latency sample
+ *
+ */
+static void lg_read(lg_conn_t *c, lg_stats_t *st)
+{
+  proto_hdr_t hdr;
+  uint64_t now;
+  uint32_t slot;
+  size_t off = 0;
+  ssize_t n;
+
+  while (1) {
+    if (lg_reserve(&c->in, &c->in_cap, c->in_len, 4096) < 0) {
+      lg_close(c, st);
+      return;
+    }
+    n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    }
+    if (n <= 0) {
+      lg_close(c, st);
+      return;
+    }
+    c->in_len += (size_t)n;
+  }
+
+  now = lg_now();
+  while (c->in_len - off >= PROTO_HDR_LEN) {
+    proto_unpack_hdr(c->in + off, &hdr);
+    if (c->in_len - off < PROTO_HDR_LEN + (size_t)hdr.len) {
+      break;
+    }
+    off += PROTO_HDR_LEN + hdr.len;
+
+    slot = hdr.id % LG_WINDOW;
+    if (c->due[slot] == 0) {
+      /* not ours */
+      continue;
+    }
+
+    if (hdr.type == PROTO_RESULT) {
+      st->ok++;
+      lg_sample(st, now > c->due[slot] ? now - c->due[slot] : 0);
+    } else if (hdr.type == PROTO_BUSY) {
+      st->busy++;
+    } else {
+      st->errors++;
+    }
+    c->due[slot] = 0;
+    c->outstanding--;
+  }
+
+  memmove(c->in, c->in + off, c->in_len - off);
+  c->in_len -= off;
+}
+
+/** @internal qsort helper
+ *
+ */
+static int lg_cmp(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+  return x < y ? -1 : x > y;
+}
+
+/** @internal latency at quantile q (0..1) in us
+ *
+ */
+static double lg_quantile(const lg_stats_t *st, double q)
+{
+  size_t i;
+
+  if (st->lat_len == 0) {
+    return 0.0;
+  }
+  i = (size_t)(q * (double)st->lat_len);
+  if (i >= st->lat_len) {
+    i = st->lat_len - 1;
+  }
+
+  return st->lat[i] == LG_UNSENT ? INFINITY : st->lat[i] / 1e3;
+}
+
+/** @internal print the summary
+ *
+ */
+static void lg_report(const load_opts_t *opts, lg_stats_t *st,
+                      int conns, double secs)
+{
+  qsort(st->lat, st->lat_len, sizeof(*st->lat), lg_cmp);
+
+  if (opts->rate > 0) {
+    printf("*** Load: %d connections, %.1f s, open loop at %.1f req/s ***\n",
+           conns, secs, opts->rate);
+  } else {
+    printf("*** Load: %d connections, %.1f s, closed loop, depth %d ***\n",
+           conns, secs, opts->depth);
+  }
+  printf("requests: %"PRIu64" sent, %"PRIu64" ok, %"PRIu64" busy, "
+         "%"PRIu64" errors, %"PRIu64" lost, %"PRIu64" late, %"PRIu64
+         " unsent\n", st->sent, st->ok, st->busy, st->errors, st->lost,
+         st->late, st->unsent);
+  /* only results count, a server answering BUSY is not fast */
+  printf("throughput: %.1f results/s\n", secs > 0 ? st->ok / secs : 0.0);
+  printf("rejected: %.1f busy/s, %.1f errors/s\n",
+         secs > 0 ? st->busy / secs : 0.0,
+         secs > 0 ? st->errors / secs : 0.0);
+  printf("latency of results: p50 %.1f us, p99 %.1f us, p99.9 %.1f us, "
+         "max %.1f us\n",
+         lg_quantile(st, 0.5), lg_quantile(st, 0.99),
+         lg_quantile(st, 0.999), lg_quantile(st, 1.0));
+}
+
+int load_gen_run(const struct sockaddr_in *srv, const load_opts_t *opts,
+                 volatile sig_atomic_t *run)
+{
+  struct epoll_event ev, events[LG_MAX_EVENTS];
+  lg_conn_t *conn, *c;
+  lg_stats_t st;
+  uint64_t start, now, end, due, seq = 0, issued = 0, step = 0, rr = 0;
+  int depth = opts->depth, open_conns = 0, alive, outstanding;
+  int epfd, i, n, timeout;
+
+  memset(&st, 0, sizeof(st));
+  if (depth < 1) {
+    depth = 1;
+  } else if (depth > LG_WINDOW) {
+    depth = LG_WINDOW;
+  }
+
+  if ((conn = calloc(opts->conns, sizeof(*conn))) == NULL ||
+      (epfd = epoll_create1(0)) < 0) {
+    perror("load generator");
+    free(conn);
+    return -1;
+  }
+
+  for (i = 0; i < opts->conns; i++) {
+    conn[i].index = i;
+    if ((conn[i].fd = lg_connect(srv)) < 0) {
+      perror("Error to connect with server");
+      continue;
+    }
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = &conn[i];
+    if (epoll_ctl(epfd, EPOLL_CTL_ADD, conn[i].fd, &ev) < 0) {
+      close(conn[i].fd);
+      conn[i].fd = -1;
+      continue;
+    }
+    open_conns++;
+  }
+  if (open_conns == 0) {
+    close(epfd);
+    free(conn);
+    return -1;
+  }
+
+  if (opts->rate > 0) {
+    step = (uint64_t)(1e9 / opts->rate);
+    if (step == 0) {
+      step = 1;
+    }
+  }
+  now = start = lg_now();
+  end = start + (uint64_t)(opts->duration * 1e9);
+
+  while (*run) {
+    now = lg_now();
+
+    for (i = 0, alive = 0; i < opts->conns; i++) {
+      alive += conn[i].fd >= 0;
+    }
+    if (alive == 0) {
+      fprintf(stderr, "*** Lost all connections to the server ***\n");
+      break;
+    }
+
+    /* queue what is due, stop sending after the duration and give
+       outstanding requests LG_DRAIN_NS to come back */
+    if (now < end) {
+      if (step > 0) {
+        for (; start + issued * step <= now; issued++) {
+          due = start + issued * step;
+          /* round robin over the open connections with room in their
+             window; none => the request waits, still due at its
+             scheduled time */
+          for (i = 0; i < opts->conns; i++, rr++) {
+            c = &conn[rr % opts->conns];
+            if (c->fd >= 0 && lg_request(c, opts, seq, due, &st) == 0) {
+              break;
+            }
+          }
+          if (i == opts->conns) {
+            break;
+          }
+          rr++;
+          seq++;
+          if (now - due > LG_LATE_NS) {
+            st.late++;
+          }
+        }
+      } else {
+        for (i = 0; i < opts->conns; i++) {
+          while (conn[i].fd >= 0 && conn[i].outstanding < depth &&
+                 lg_request(&conn[i], opts, seq, now, &st) == 0) {
+            seq++;
+          }
+        }
+      }
+    } else {
+      for (i = 0, outstanding = 0; i < opts->conns; i++) {
+        outstanding += conn[i].outstanding;
+      }
+      if (outstanding == 0 || now > end + LG_DRAIN_NS) {
+        break;
+      }
+    }
+
+    for (i = 0; i < opts->conns; i++) {
+      if (conn[i].fd >= 0 && conn[i].out_len > 0) {
+        lg_flush(&conn[i], &st);
+      }
+    }
+
+    /* wake up for the next scheduled request, a waiting one is
+       retried as soon as replies free some room */
+    timeout = 100;
+    if (step > 0 && now < end) {
+      due = start + issued * step;
+      timeout = due > now ? (int)((due - now) / 1000000) : 1;
+    }
+    n = epoll_wait(epfd, events, LG_MAX_EVENTS, timeout);
+    for (i = 0; i < n; i++) {
+      c = events[i].data.ptr;
+
+      if (c->fd < 0) {
+        continue;
+      }
+      if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP |
+                              EPOLLERR)) {
+        lg_read(c, &st);
+      }
+      if (c->fd >= 0 && (events[i].events & EPOLLOUT) && c->out_len) {
+        lg_flush(c, &st);
+      }
+    }
+  }
+
+  /* requests that were due but never went out */
+  for (; step > 0 && start + issued * step < (now < end ? now : end);
+       issued++) {
+    st.unsent++;
+    lg_sample(&st, LG_UNSENT);
+  }
+
+  /* what did not come back is lost */
+  for (i = 0; i < opts->conns; i++) {
+    lg_close(&conn[i], &st);
+    free(conn[i].in);
+    free(conn[i].out);
+  }
+  close(epfd);
+
+  lg_report(opts, &st, open_conns,
+            ((now < end ? now : end) - start) / 1e9);
+
+  free(st.lat);
+  free(conn);
+
+  return 0;
+}
+
+/*EOF*/
@@ -0,0 +1,39 @@
+/**
+ * @file load_gen.h
+ * @date 17 Oct 2026
+ * @brief Load generator of the hash cracker client (-b)
+ *
+ *        Opens a number of connections and keeps CRACK requests in
+ *        flight on all of them from one epoll loop, either a fixed
+ *        number per connection (closed loop) or at a fixed total rate
+ *        no matter how fast the server answers (open loop).
+ *
+ */
+
+#ifndef LOAD_GEN_H
+#define LOAD_GEN_H
+
+#include <stddef.h>
+#include <signal.h>
+#include <netinet/in.h>
+
+/** @brief load generator settings */
+typedef struct load_opts_s {
+  int conns;            /**< concurrent connections */
+  double duration;      /**< seconds to send requests */
+  double rate;          /**< total requests/s, 0 => closed loop */
+  int depth;            /**< closed loop: requests in flight per conn */
+  char **corpus;        /**< strings to crack, NULL => generated */
+  size_t corpus_len;
+} load_opts_t;
+
+/** @brief run the load and print throughput, errors and latencies
+ *
+ *  @retrun 0 => ok, -1 => no connection could be set up
+ */
+int load_gen_run(const struct sockaddr_in *srv, const load_opts_t *opts,
+                 volatile sig_atomic_t *run);
+
+#endif
+
+/*EOF*/
@@ -0,0 +1,338 @@
+/**
+ * @file metrics.c
+ * @date 17 Oct 2026
+ * @brief Server counters, gauges and latency histograms
+ *
+ *        A thread finds its shard through a pthread key, the first
+ *        update allocates it and links it into the shard list.  Only
+ *        the owner writes a shard, with relaxed atomic load/store
+ *        pairs so a concurrent snapshot reads whole values.  Gauges are
+ *        updated from different threads (a connection opens on one
+ *        reactor, a job ends on a worker) and are plain atomics.
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#define _POSIX_C_SOURCE     200809L
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <pthread.h>
+#include "metrics.h"
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define HIST_SUB_BITS   4
+#define HIST_SUB        (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS    ((64 - HIST_SUB_BITS + 1) * HIST_SUB)
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef struct metrics_hist_s {
+  uint64_t bucket[HIST_BUCKETS];
+  uint64_t sum;
+  uint64_t max;
+} metrics_hist_t;
+
+typedef struct metrics_shard_s {
+  struct metrics_shard_s *next;
+  uint64_t counter[METRIC_COUNTERS];
+  metrics_hist_t hist[METRIC_HISTOGRAMS];
+} metrics_shard_t;
+
+struct metrics_s {
+  pthread_key_t key;
+  pthread_mutex_t lock;
+  metrics_shard_t *shards;
+  uint64_t start;
+  int64_t gauge[METRIC_GAUGES];
+};
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal bucket of v, values < 16 are exact
+ *
+ */
+static unsigned hist_bucket(uint64_t v)
+{
+  unsigned e;
+
+  if (v < HIST_SUB) {
+    return (unsigned)v;
+  }
+  e = 63 - (unsigned)__builtin_clzll(v);
+
+  return (e - HIST_SUB_BITS + 1) * HIST_SUB +
+         (unsigned)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+}
+
+/** @internal largest value that falls into bucket i
+ *
+ */
+static uint64_t hist_upper(unsigned i)
+{
+  unsigned e;
+
+  if (i < HIST_SUB) {
+    return i;
+  }
+  e = i / HIST_SUB + HIST_SUB_BITS - 1;
+
+  return ((uint64_t)(HIST_SUB + i % HIST_SUB) << (e - HIST_SUB_BITS)) +
+         ((uint64_t)1 << (e - HIST_SUB_BITS)) - 1;
+}
+
+/** @internal single writer increment, readable by a snapshot
+ *
+ */
+static void shard_add(uint64_t *v, uint64_t n)
+{
+  __atomic_store_n(v, __atomic_load_n(v, __ATOMIC_RELAXED) + n,
+                   __ATOMIC_RELAXED);
+}
+
+/** @internal shard of the calling thread
+ *
+ *  @retrun NULL => out of memory, the update is lost
+ */
+static metrics_shard_t *metrics_shard(metrics_t *m)
+{
+  metrics_shard_t *s = pthread_getspecific(m->key);
+
+  if (s != NULL) {
+    return s;
+  }
+  if ((s = calloc(1, sizeof(*s))) == NULL) {
+    return NULL;
+  }
+  pthread_setspecific(m->key, s);
+
+  pthread_mutex_lock(&m->lock);
+  s->next = m->shards;
+  m->shards = s;
+  pthread_mutex_unlock(&m->lock);
+
+  return s;
+}
+
+metrics_t *metrics_create(void)
+{
+  metrics_t *m;
+
+  if ((m = calloc(1, sizeof(*m))) == NULL) {
+    return NULL;
+  }
+  /* shards outlive their threads, no destructor */
+  if (pthread_key_create(&m->key, NULL) != 0) {
+    free(m);
+    return NULL;
+  }
+  pthread_mutex_init(&m->lock, NULL);
+  m->start = metrics_now();
+
+  return m;
+}
+
+void metrics_destroy(metrics_t *m)
+{
+  metrics_shard_t *s;
+
+  if (m == NULL) {
+    return;
+  }
+
+  while ((s = m->shards) != NULL) {
+    m->shards = s->next;
+    free(s);
+  }
+  pthread_key_delete(m->key);
+  pthread_mutex_destroy(&m->lock);
+  free(m);
+}
+
+uint64_t metrics_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+void metrics_add(metrics_t *m, metric_counter_t counter, uint64_t n)
+{
+  metrics_shard_t *s;
+
+  if (m != NULL && (s = metrics_shard(m)) != NULL) {
+    shard_add(&s->counter[counter], n);
+  }
+}
+
+void metrics_gauge_add(metrics_t *m, metric_gauge_t gauge,
+                       int64_t delta)
+{
+  if (m != NULL) {
+    __atomic_fetch_add(&m->gauge[gauge], delta, __ATOMIC_RELAXED);
+  }
+}
+
+void metrics_record(metrics_t *m, metric_hist_t hist, uint64_t ns)
+{
+  metrics_shard_t *s;
+  metrics_hist_t *h;
+
+  if (m == NULL || (s = metrics_shard(m)) == NULL) {
+    return;
+  }
+
+  h = &s->hist[hist];
+  shard_add(&h->bucket[hist_bucket(ns)], 1);
+  shard_add(&h->sum, ns);
+  if (ns > h->max) {
+    __atomic_store_n(&h->max, ns, __ATOMIC_RELAXED);
+  }
+}
+
+void metrics_snapshot(metrics_t *m, metrics_snapshot_t *snap)
+{
+  static const unsigned pct[4] = { 500, 900, 990, 999 };
+  uint64_t *merged, *q[4];
+  uint64_t seen, v;
+  metric_summary_t *sum;
+  metrics_shard_t *s;
+  unsigned h, i, k;
+
+  memset(snap, 0, sizeof(*snap));
+  if (m == NULL) {
+    return;
+  }
+  snap->uptime = metrics_now() - m->start;
+  for (i = 0; i < METRIC_GAUGES; i++) {
+    snap->gauge[i] = __atomic_load_n(&m->gauge[i], __ATOMIC_RELAXED);
+  }
+
+  if ((merged = calloc(METRIC_HISTOGRAMS * HIST_BUCKETS,
+                       sizeof(uint64_t))) == NULL) {
+    return;
+  }
+
+  pthread_mutex_lock(&m->lock);
+  for (s = m->shards; s != NULL; s = s->next) {
+    for (i = 0; i < METRIC_COUNTERS; i++) {
+      snap->counter[i] += __atomic_load_n(&s->counter[i],
+                                          __ATOMIC_RELAXED);
+    }
+    for (h = 0; h < METRIC_HISTOGRAMS; h++) {
+      sum = &snap->hist[h];
+      for (i = 0; i < HIST_BUCKETS; i++) {
+        merged[h * HIST_BUCKETS + i] +=
+          __atomic_load_n(&s->hist[h].bucket[i], __ATOMIC_RELAXED);
+      }
+      sum->sum += __atomic_load_n(&s->hist[h].sum, __ATOMIC_RELAXED);
+      v = __atomic_load_n(&s->hist[h].max, __ATOMIC_RELAXED);
+      if (v > sum->max) {
+        sum->max = v;
+      }
+    }
+  }
+  pthread_mutex_unlock(&m->lock);
+
+  /* percentiles from the merged buckets */
+  for (h = 0; h < METRIC_HISTOGRAMS; h++) {
+    sum = &snap->hist[h];
+    q[0] = &sum->p50;
+    q[1] = &sum->p90;
+    q[2] = &sum->p99;
+    q[3] = &sum->p999;
+    for (i = 0; i < HIST_BUCKETS; i++) {
+      sum->count += merged[h * HIST_BUCKETS + i];
+    }
+    for (i = 0, k = 0, seen = 0; i < HIST_BUCKETS && k < 4; i++) {
+      seen += merged[h * HIST_BUCKETS + i];
+      while (k < 4 && sum->count > 0 &&
+             (sum->count * pct[k] + 999) / 1000 <= seen) {
+        v = hist_upper(i);
+        *q[k++] = v < sum->max ? v : sum->max;
+      }
+    }
+  }
+
+  free(merged);
+}
+
+/** @internal append one histogram line, values in us
+ *
+ */
+static size_t format_hist(char *buf, size_t cap, const char *name,
+                          const metric_summary_t *h)
+{
+  return (size_t)snprintf(buf, cap,
+                          "%-10s n %"PRIu64" avg %.1f p50 %.1f p90 %.1f "
+                          "p99 %.1f p99.9 %.1f max %.1f us\n",
+                          name, h->count,
+                          h->count ? h->sum / 1e3 / h->count : 0.0,
+                          h->p50 / 1e3, h->p90 / 1e3, h->p99 / 1e3,
+                          h->p999 / 1e3, h->max / 1e3);
+}
+
+size_t metrics_format(const metrics_snapshot_t *snap,
+                      const metrics_snapshot_t *prev, char *buf,
+                      size_t cap)
+{
+  static const char *hist_name[METRIC_HISTOGRAMS] = {
+    "queue", "search", "send"
+  };
+  double secs;
+  uint64_t req, bytes_in, bytes_out;
+  size_t len = 0;
+  unsigned h;
+
+  secs = (snap->uptime - (prev ? prev->uptime : 0)) / 1e9;
+  if (secs <= 0) {
+    secs = 1e-9;
+  }
+  req = snap->counter[METRIC_REQUESTS] -
+        (prev ? prev->counter[METRIC_REQUESTS] : 0);
+  bytes_in = snap->counter[METRIC_BYTES_IN] -
+             (prev ? prev->counter[METRIC_BYTES_IN] : 0);
+  bytes_out = snap->counter[METRIC_BYTES_OUT] -
+              (prev ? prev->counter[METRIC_BYTES_OUT] : 0);
+
+#define FMT_APPEND(...) \
+  len += (size_t)snprintf(buf + (len < cap ? len : cap), \
+                          len < cap ? cap - len : 0, __VA_ARGS__)
+
+  FMT_APPEND("uptime %.1f s, requests %"PRIu64" (%.1f/s), "
+             "batch items %"PRIu64", jobs %"PRIu64"\n",
+             snap->uptime / 1e9, snap->counter[METRIC_REQUESTS],
+             req / secs, snap->counter[METRIC_BATCH_ITEMS],
+             snap->counter[METRIC_JOBS_DONE]);
+  FMT_APPEND("busy %"PRIu64", errors %"PRIu64", timeouts %"PRIu64
+             ", cancelled %"PRIu64", connections %"PRId64
+             ", in flight %"PRId64"\n",
+             snap->counter[METRIC_BUSY], snap->counter[METRIC_ERRORS],
+             snap->counter[METRIC_TIMEOUTS],
+             snap->counter[METRIC_CANCELLED],
+             snap->gauge[METRIC_CONNECTIONS],
+             snap->gauge[METRIC_INFLIGHT]);
+  FMT_APPEND("in %"PRIu64" B (%.1f kB/s), out %"PRIu64" B "
+             "(%.1f kB/s)\n",
+             snap->counter[METRIC_BYTES_IN], bytes_in / secs / 1e3,
+             snap->counter[METRIC_BYTES_OUT], bytes_out / secs / 1e3);
+
+#undef FMT_APPEND
+
+  for (h = 0; h < METRIC_HISTOGRAMS; h++) {
+    len += format_hist(buf + (len < cap ? len : cap),
+                       len < cap ? cap - len : 0, hist_name[h],
+                       &snap->hist[h]);
+  }
+
+  return len;
+}
+
+/*EOF*/
@@ -0,0 +1,110 @@
+/**
+ * @file metrics.h
+ * @date 17 Oct 2026
+ * @brief Server counters, gauges and latency histograms
+ *
+ *        Every thread updates a shard of its own without locks or
+ *        atomic read-modify-write instructions; a snapshot merges all
+ *        shards.  Histograms are log-linear (HDR style): 16 buckets
+ *        per power of two, i.e. values are kept with ~6% precision.
+ *
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct metrics_s metrics_t;
+
+/** @brief monotonic event counters */
+typedef enum {
+  METRIC_REQUESTS = 0,  /**< request frames received */
+  METRIC_BATCH_ITEMS,   /**< strings in CRACK_BATCH requests */
+  METRIC_JOBS_DONE,     /**< jobs finished by a worker */
+  METRIC_BUSY,          /**< BUSY replies */
+  METRIC_ERRORS,        /**< ERROR replies */
+  METRIC_TIMEOUTS,      /**< TIMEOUT replies */
+  METRIC_CANCELLED,     /**< jobs stopped by disconnect or CANCEL */
+  METRIC_BYTES_IN,      /**< bytes read from clients */
+  METRIC_BYTES_OUT,     /**< bytes written to clients */
+  METRIC_COUNTERS
+} metric_counter_t;
+
+/** @brief values that go up and down */
+typedef enum {
+  METRIC_CONNECTIONS = 0, /**< open client connections */
+  METRIC_INFLIGHT,        /**< jobs queued or running */
+  METRIC_GAUGES
+} metric_gauge_t;
+
+/** @brief latency histograms, values in ns */
+typedef enum {
+  METRIC_QUEUE_WAIT = 0, /**< submit => a worker picks the job up */
+  METRIC_SEARCH,         /**< worker time for one job */
+  METRIC_SEND,           /**< reply queued => written to the socket */
+  METRIC_HISTOGRAMS
+} metric_hist_t;
+
+/** @brief summary of one histogram */
+typedef struct metric_summary_s {
+  uint64_t count;
+  uint64_t sum;
+  uint64_t p50;
+  uint64_t p90;
+  uint64_t p99;
+  uint64_t p999;
+  uint64_t max;
+} metric_summary_t;
+
+/** @brief merged view of all shards */
+typedef struct metrics_snapshot_s {
+  uint64_t uptime;      /**< ns since metrics_create() */
+  uint64_t counter[METRIC_COUNTERS];
+  int64_t gauge[METRIC_GAUGES];
+  metric_summary_t hist[METRIC_HISTOGRAMS];
+} metrics_snapshot_t;
+
+/** @brief create the metrics
+ *
+ *  @retrun NULL on error
+ */
+metrics_t *metrics_create(void);
+
+/** @brief free the metrics and all shards
+ *
+ *  No thread may update them any more.
+ */
+void metrics_destroy(metrics_t *m);
+
+/** @brief monotonic clock in ns */
+uint64_t metrics_now(void);
+
+/** @brief add n to a counter of the calling thread's shard */
+void metrics_add(metrics_t *m, metric_counter_t counter, uint64_t n);
+
+/** @brief add delta to a gauge */
+void metrics_gauge_add(metrics_t *m, metric_gauge_t gauge,
+                       int64_t delta);
+
+/** @brief record one latency in ns */
+void metrics_record(metrics_t *m, metric_hist_t hist, uint64_t ns);
+
+/** @brief merge all shards */
+void metrics_snapshot(metrics_t *m, metrics_snapshot_t *snap);
+
+/** @brief human readable report, one topic per line
+ *
+ *  Rates are computed over the time since prev, or since start if
+ *  prev is NULL.
+ *
+ *  @retrun length of the text (as snprintf)
+ */
+size_t metrics_format(const metrics_snapshot_t *snap,
+                      const metrics_snapshot_t *prev, char *buf,
+                      size_t cap);
+
+#endif
+
+/*EOF*/
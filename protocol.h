@@ -0,0 +1,152 @@
+/**
+ * @file protocol.h
+ * @date 17 Oct 2026
+ * @brief Wire format shared by hash_client and hash_server
+ *
+ *        After the "ACK\r\n" greeting every message is a frame: a
+ *        12 byte header in network byte order followed by len bytes
+ *        of payload.
+ *
+ *          0       4       8     10     12
+ *          +-------+-------+------+------+---------------+
+ *          |  len  |  id   | type | flags| payload ...   |
+ *          +-------+-------+------+------+---------------+
+ *
+ *        The id is chosen by the client and echoed in the response,
+ *        so a client may have any number of requests in flight and
+ *        the responses may arrive in any order.
+ *
+ *        A request with flag DEADLINE starts its payload with a u32
+ *        timeout in ms; if the answer is not ready by then the server
+ *        stops the search and answers TIMEOUT.  CANCEL stops the
+ *        request with the same id without an answer.
+ *
+ *        A CRACK_BATCH payload is a u32 count followed by count
+ *        entries of u32 length + string, the BATCH_RESULT payload is
+ *        the u32 count followed by one u32 collision per entry (all
+ *        integers in network byte order).
+ *
+ *        A CRACK_STRING payload is the u32 length of the wanted
+ *        collision, a u32 count followed by count alphabet characters
+ *        and the string to crack; STRING_RESULT carries a collision
+ *        of that length made of alphabet characters only.
+ *
+ *        A CRACK_STREAM payload is the u64 length of a body (high u32
+ *        first) that follows the frame as raw bytes, not framed; the
+ *        server hashes it as it arrives and answers RESULT like for
+ *        CRACK.  A stream answered BUSY right away is read and
+ *        dropped, the body must still be sent.
+ *
+ *        Cluster mode: a worker server connects to the coordinator
+ *        and sends REGISTER, from then on the coordinator sends
+ *        CRACK_RANGE requests (u32 crc, u32 first, u32 last candidate)
+ *        over that connection and the worker answers RANGE_RESULT
+ *        (u32 status, u32 candidate).  A cancelled CRACK_RANGE is
+ *        still answered, with status CANCELLED.
+ *
+ */
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define PROTO_HDR_LEN       12
+#define PROTO_MAX_PAYLOAD   (1024 * 1024)
+#define PROTO_MAX_BATCH     65536
+
+/* requests */
+#define PROTO_CRACK         0x0001  /* payload: string to crack */
+#define PROTO_CRACK_BATCH   0x0002  /* payload: list of strings */
+#define PROTO_STATS         0x0003  /* no payload */
+#define PROTO_CRACK_RANGE   0x0004  /* payload: crc, first, last */
+#define PROTO_CANCEL        0x0005  /* no payload, no response */
+#define PROTO_REGISTER      0x0006  /* no payload, no response */
+#define PROTO_CRACK_STRING  0x0007  /* payload: length, alphabet, string */
+#define PROTO_CRACK_STREAM  0x0008  /* payload: u64 length, body follows */
+
+/* responses */
+#define PROTO_RESULT        0x0081  /* payload: "0x%08x" collision */
+#define PROTO_BUSY          0x0082  /* no payload, retry later */
+#define PROTO_BATCH_RESULT  0x0083  /* payload: list of collisions */
+#define PROTO_STATS_RESULT  0x0084  /* payload: metrics report text */
+#define PROTO_RANGE_RESULT  0x0085  /* payload: status, candidate */
+#define PROTO_STRING_RESULT 0x0086  /* payload: collision string */
+#define PROTO_TIMEOUT       0x0087  /* no payload, deadline passed */
+#define PROTO_ERROR         0x00FF  /* payload: error text */
+
+/* flags */
+#define PROTO_FLAG_DEADLINE 0x0001  /* payload starts with u32 ms */
+
+/* RANGE_RESULT status */
+#define PROTO_RANGE_NONE        0
+#define PROTO_RANGE_FOUND       1
+#define PROTO_RANGE_CANCELLED   2
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef struct proto_hdr_s {
+  uint32_t len;
+  uint32_t id;
+  uint16_t type;
+  uint16_t flags;
+} proto_hdr_t;
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @brief write hdr to buf[PROTO_HDR_LEN] in network byte order */
+static inline void proto_pack_hdr(uint8_t *buf, const proto_hdr_t *hdr)
+{
+  uint32_t len = htonl(hdr->len);
+  uint32_t id = htonl(hdr->id);
+  uint16_t type = htons(hdr->type);
+  uint16_t flags = htons(hdr->flags);
+
+  memcpy(buf + 0, &len, 4);
+  memcpy(buf + 4, &id, 4);
+  memcpy(buf + 8, &type, 2);
+  memcpy(buf + 10, &flags, 2);
+}
+
+/** @brief read hdr from buf[PROTO_HDR_LEN] */
+static inline void proto_unpack_hdr(const uint8_t *buf, proto_hdr_t *hdr)
+{
+  uint32_t len, id;
+  uint16_t type, flags;
+
+  memcpy(&len, buf + 0, 4);
+  memcpy(&id, buf + 4, 4);
+  memcpy(&type, buf + 8, 2);
+  memcpy(&flags, buf + 10, 2);
+
+  hdr->len = ntohl(len);
+  hdr->id = ntohl(id);
+  hdr->type = ntohs(type);
+  hdr->flags = ntohs(flags);
+}
+
+/** @brief read a u32 in network byte order */
+static inline uint32_t proto_get_u32(const uint8_t *buf)
+{
+  uint32_t v;
+
+  memcpy(&v, buf, 4);
+
+  return ntohl(v);
+}
+
+/** @brief write a u32 in network byte order */
+static inline void proto_put_u32(uint8_t *buf, uint32_t v)
+{
+  v = htonl(v);
+  memcpy(buf, &v, 4);
+}
+
+#endif
+
+/*EOF*/
@@ -0,0 +1,260 @@
+/**
+ * @file result_cache.c
+ * @date 17 Oct 2026
+ * @brief Bounded result cache keyed by the target crc
+ *
+ *        The cache is split into shards by key so concurrent workers
+ *        rarely wait for the same lock.  Every shard owns a fixed
+ *        array of entries with a reference bit and an open addressing
+ *        index (linear probing) from key to entry.  A full shard
+ *        evicts with a clock hand sweeping the entries: referenced
+ *        entries get a second chance, the first unreferenced one is
+ *        replaced.
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#include <stdlib.h>
+#include <pthread.h>
+#include "result_cache.h"
+
+/*****************************************************************************/
+/******************************************************************* defines */
+#define CACHE_SHARDS        16
+#define CACHE_EMPTY         UINT32_MAX
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+typedef struct cache_entry_s {
+  uint32_t key;
+  uint32_t value;
+  uint8_t ref;
+} cache_entry_t;
+
+typedef struct cache_shard_s {
+  pthread_mutex_t lock;
+  cache_entry_t *entry;
+  uint32_t *index;          /* entry number or CACHE_EMPTY */
+  uint32_t index_mask;
+  uint32_t capacity;
+  uint32_t used;
+  uint32_t hand;
+} cache_shard_t;
+
+struct result_cache_s {
+  cache_shard_t shard[CACHE_SHARDS];
+  uint64_t hits;
+  uint64_t misses;
+};
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal spread the crc bits, the key is hashed twice (shard and
+ *  index) so they use different halves
+ */
+static uint32_t cache_hash(uint32_t key)
+{
+  key ^= key >> 16;
+  key *= 0x7feb352d;
+  key ^= key >> 15;
+  key *= 0x846ca68b;
+  key ^= key >> 16;
+
+  return key;
+}
+
+static cache_shard_t *cache_shard(result_cache_t *cache, uint32_t key)
+{
+  return &cache->shard[cache_hash(key) % CACHE_SHARDS];
+}
+
+/** @internal index slot of key, or of the empty slot ending its probe
+ *
+ */
+static uint32_t cache_find(const cache_shard_t *s, uint32_t key)
+{
+  uint32_t pos = (cache_hash(key) >> 8) & s->index_mask;
+
+  while (s->index[pos] != CACHE_EMPTY &&
+         s->entry[s->index[pos]].key != key) {
+    pos = (pos + 1) & s->index_mask;
+  }
+
+  return pos;
+}
+
+/** @internal remove index slot pos, backward shift deletion keeps all
+ *  probe sequences intact without tombstones
+ */
+static void cache_unlink(cache_shard_t *s, uint32_t pos)
+{
+  uint32_t next = pos;
+  uint32_t home;
+
+  while (1) {
+    next = (next + 1) & s->index_mask;
+    if (s->index[next] == CACHE_EMPTY) {
+      break;
+    }
+    home = (cache_hash(s->entry[s->index[next]].key) >> 8) &
+           s->index_mask;
+    /* move next into the hole unless its home lies in (pos, next] */
+    if (((next - home) & s->index_mask) >=
+        ((next - pos) & s->index_mask)) {
+      s->index[pos] = s->index[next];
+      pos = next;
+    }
+  }
+  s->index[pos] = CACHE_EMPTY;
+}
+
+result_cache_t *result_cache_create(size_t capacity)
+{
+  result_cache_t *cache;
+  cache_shard_t *s;
+  uint32_t per_shard, slots;
+  int i;
+
+  if (capacity == 0) {
+    return NULL;
+  }
+  if (capacity > UINT32_MAX / 4) {
+    capacity = UINT32_MAX / 4;
+  }
+
+  cache = calloc(1, sizeof(*cache));
+  if (cache == NULL) {
+    return NULL;
+  }
+
+  per_shard = (uint32_t)((capacity + CACHE_SHARDS - 1) / CACHE_SHARDS);
+  /* keep the index at most half full */
+  for (slots = 2; slots < 2 * per_shard; slots <<= 1) {
+  }
+
+  for (i = 0; i < CACHE_SHARDS; i++) {
+    s = &cache->shard[i];
+    pthread_mutex_init(&s->lock, NULL);
+    s->capacity = per_shard;
+    s->index_mask = slots - 1;
+    s->entry = calloc(per_shard, sizeof(*s->entry));
+    s->index = malloc(slots * sizeof(*s->index));
+    if (s->entry == NULL || s->index == NULL) {
+      result_cache_destroy(cache);
+      return NULL;
+    }
+    for (slots = 0; slots <= s->index_mask; slots++) {
+      s->index[slots] = CACHE_EMPTY;
+    }
+  }
+
+  return cache;
+}
+
+void result_cache_destroy(result_cache_t *cache)
+{
+  int i;
+
+  if (cache == NULL) {
+    return;
+  }
+
+  for (i = 0; i < CACHE_SHARDS; i++) {
+    pthread_mutex_destroy(&cache->shard[i].lock);
+    free(cache->shard[i].entry);
+    free(cache->shard[i].index);
+  }
+  free(cache);
+}
+
+int result_cache_get(result_cache_t *cache, uint32_t key,
+                     uint32_t *value)
+{
+  cache_shard_t *s;
+  uint32_t pos;
+  int ret = -1;
+
+  if (cache == NULL) {
+    return -1;
+  }
+
+  s = cache_shard(cache, key);
+  pthread_mutex_lock(&s->lock);
+  pos = cache_find(s, key);
+  if (s->index[pos] != CACHE_EMPTY) {
+    s->entry[s->index[pos]].ref = 1;
+    *value = s->entry[s->index[pos]].value;
+    ret = 0;
+  }
+  pthread_mutex_unlock(&s->lock);
+
+  __atomic_fetch_add(ret == 0 ? &cache->hits : &cache->misses, 1,
+                     __ATOMIC_RELAXED);
+
+  return ret;
+}
+
+void result_cache_put(result_cache_t *cache, uint32_t key,
+                      uint32_t value)
+{
+  cache_shard_t *s;
+  cache_entry_t *e;
+  uint32_t pos, victim;
+
+  if (cache == NULL) {
+    return;
+  }
+
+  s = cache_shard(cache, key);
+  pthread_mutex_lock(&s->lock);
+
+  pos = cache_find(s, key);
+  if (s->index[pos] != CACHE_EMPTY) {
+    /* already present (concurrent miss on the same key) */
+    e = &s->entry[s->index[pos]];
+    e->value = value;
+    e->ref = 1;
+    pthread_mutex_unlock(&s->lock);
+    return;
+  }
+
+  if (s->used < s->capacity) {
+    victim = s->used++;
+  } else {
+    /* clock sweep: clear reference bits until an unreferenced entry */
+    while (s->entry[s->hand].ref) {
+      s->entry[s->hand].ref = 0;
+      s->hand = (s->hand + 1) % s->capacity;
+    }
+    victim = s->hand;
+    s->hand = (s->hand + 1) % s->capacity;
+    cache_unlink(s, cache_find(s, s->entry[victim].key));
+    /* the unlink may have moved the free slot of the new key */
+    pos = cache_find(s, key);
+  }
+
+  e = &s->entry[victim];
+  e->key = key;
+  e->value = value;
+  e->ref = 0;
+  s->index[pos] = victim;
+
+  pthread_mutex_unlock(&s->lock);
+}
+
+void result_cache_stats(result_cache_t *cache, uint64_t *hits,
+                        uint64_t *misses)
+{
+  *hits = 0;
+  *misses = 0;
+  if (cache == NULL) {
+    return;
+  }
+
+  *hits = __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+  *misses = __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+}
+
+/*EOF*/
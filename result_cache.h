@@ -0,0 +1,42 @@
+/**
+ * @file result_cache.h
+ * @date 17 Oct 2026
+ * @brief Bounded result cache keyed by the target crc
+ *
+ *        Thread safe, entries are evicted with the CLOCK (second
+ *        chance) algorithm once the capacity is reached.
+ *
+ */
+
+#ifndef RESULT_CACHE_H
+#define RESULT_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct result_cache_s result_cache_t;
+
+/** @brief create a cache for capacity entries
+ *
+ *  @retrun NULL if capacity is 0 (cache disabled) or out of memory,
+ *          all other functions accept a NULL cache
+ */
+result_cache_t *result_cache_create(size_t capacity);
+void result_cache_destroy(result_cache_t *cache);
+
+/** @brief look up key
+ *
+ *  @retrun 0 => hit, *value is valid, -1 => miss
+ */
+int result_cache_get(result_cache_t *cache, uint32_t key,
+                     uint32_t *value);
+void result_cache_put(result_cache_t *cache, uint32_t key,
+                      uint32_t value);
+
+/** @brief hit/miss counters since creation */
+void result_cache_stats(result_cache_t *cache, uint64_t *hits,
+                        uint64_t *misses);
+
+#endif
+
+/*EOF*/
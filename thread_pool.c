@@ -0,0 +1,369 @@
+/**
+ * @file thread_pool.c
+ * @date 17 Oct 2026
+ * @brief Fixed size worker pool fed by a bounded job queue
+ *
+ *        Every job object has an entry with the link of its flow
+ *        queue, all guarded by one mutex; producers and workers may be
+ *        any number of threads.  The bound of the queue is enforced by
+ *        the free list in thread_pool_job_get().  Flows with queued
+ *        jobs are on the active list, the one at its head starts jobs
+ *        while its deficit covers their cost, otherwise it gets its
+ *        quantum and moves to the tail (deficit round robin).
+ *
+ */
+
+/*****************************************************************************/
+/****************************************************************** includes */
+#include <stdlib.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "thread_pool.h"
+
+/*****************************************************************************/
+/******************************************************************** typedef*/
+
+/* queue link of job i of the pool */
+typedef struct pool_entry_s {
+  struct pool_entry_s *next;
+  unsigned cost;
+} pool_entry_t;
+
+struct thread_pool_flow_s {
+  struct thread_pool_flow_s *next;
+  pool_entry_t *head;
+  pool_entry_t *tail;
+  size_t held;          /* taken or queued, not yet started */
+  unsigned long quantum;
+  unsigned long deficit;
+};
+
+struct thread_pool_s {
+  pthread_mutex_t lock;
+  pthread_cond_t not_empty;
+  pool_work_fn_t fn;
+  int stop;
+
+  /* job storage and free list */
+  char *jobs;
+  size_t job_size;
+  pool_entry_t *entry;
+  thread_pool_flow_t **flow_of;
+  void **free_list;
+  size_t free_count;
+
+  /* flows with queued jobs, served from the head */
+  thread_pool_flow_t *active;
+  thread_pool_flow_t *active_tail;
+  size_t active_count;
+  thread_pool_flow_t fifo;
+  size_t count;
+
+  pthread_t *thread;
+  int workers;
+};
+
+/*****************************************************************************/
+/****************************************************************** functions*/
+
+/** @internal push a job back to the free list, lock must be held
+ *
+ */
+static void pool_recycle(thread_pool_t *pool, void *job)
+{
+  pool->free_list[pool->free_count++] = job;
+}
+
+/** @internal index of a job object
+ *
+ */
+static size_t pool_index(const thread_pool_t *pool, const void *job)
+{
+  return (size_t)((const char *)job - pool->jobs) / pool->job_size;
+}
+
+/** @internal next job by deficit round robin, lock must be held and
+ *            a job queued
+ *
+ */
+static void *pool_next(thread_pool_t *pool)
+{
+  thread_pool_flow_t *f;
+  pool_entry_t *e;
+  unsigned long rounds, need;
+  size_t turns = 0;
+
+  /* a flow short of credit gets its quantum and goes to the back */
+  while (1) {
+    f = pool->active;
+    if (f->deficit >= f->head->cost) {
+      break;
+    }
+    f->deficit += f->quantum;
+    if (f->next != NULL) {
+      pool->active = f->next;
+      pool->active_tail->next = f;
+      pool->active_tail = f;
+      f->next = NULL;
+    }
+
+    /* a whole round and nobody could start (expensive jobs only) =>
+       skip the rounds until the first one can */
+    if (++turns == pool->active_count) {
+      rounds = ULONG_MAX;
+      for (f = pool->active; f != NULL; f = f->next) {
+        need = f->deficit >= f->head->cost ? 0 :
+               (f->head->cost - f->deficit + f->quantum - 1) / f->quantum;
+        rounds = need < rounds ? need : rounds;
+      }
+      for (f = pool->active; rounds > 1 && f != NULL; f = f->next) {
+        f->deficit += (rounds - 1) * f->quantum;
+      }
+      turns = 0;
+    }
+  }
+
+  e = f->head;
+  f->deficit -= e->cost;
+  f->held--;
+  if ((f->head = e->next) == NULL) {
+    /* idle flows do not save up credit */
+    f->tail = NULL;
+    f->deficit = 0;
+    pool->active = f->next;
+    pool->active_count--;
+    f->next = NULL;
+  }
+  pool->count--;
+
+  return pool->jobs + (size_t)(e - pool->entry) * pool->job_size;
+}
+
+/** @internal worker thread
+ *
+ */
+static void *pool_worker(void *ptr)
+{
+  thread_pool_t *pool = ptr;
+  void *job;
+
+  pthread_mutex_lock(&pool->lock);
+  while (1) {
+    while (pool->count == 0 && !pool->stop) {
+      pthread_cond_wait(&pool->not_empty, &pool->lock);
+    }
+    /* stop once the queue is drained, every queued job still runs
+       so its owner can release what it holds */
+    if (pool->stop && pool->count == 0) {
+      break;
+    }
+
+    job = pool_next(pool);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool->fn(job);
+
+    pthread_mutex_lock(&pool->lock);
+    pool_recycle(pool, job);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+thread_pool_t *thread_pool_create(int workers, size_t queue_len,
+                                  size_t job_size, pool_work_fn_t fn)
+{
+  thread_pool_t *pool;
+  size_t i, total;
+
+  if (workers <= 0) {
+    workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers <= 0) {
+      workers = 1;
+    }
+  }
+
+  pool = calloc(1, sizeof(*pool));
+  if (pool == NULL) {
+    return NULL;
+  }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->not_empty, NULL);
+
+  total = queue_len + (size_t)workers;
+  pool->fn = fn;
+  pool->job_size = job_size > 0 ? job_size : 1;
+  pool->fifo.quantum = THREAD_POOL_QUANTUM;
+  pool->jobs = calloc(total, pool->job_size);
+  pool->entry = calloc(total, sizeof(pool_entry_t));
+  pool->flow_of = calloc(total, sizeof(thread_pool_flow_t *));
+  pool->free_list = malloc(total * sizeof(void *));
+  pool->thread = malloc((size_t)workers * sizeof(pthread_t));
+  if (pool->jobs == NULL || pool->entry == NULL ||
+      pool->flow_of == NULL || pool->free_list == NULL ||
+      pool->thread == NULL) {
+    thread_pool_destroy(pool);
+    return NULL;
+  }
+  for (i = 0; i < total; i++) {
+    pool_recycle(pool, pool->jobs + i * pool->job_size);
+  }
+
+  for (pool->workers = 0; pool->workers < workers; pool->workers++) {
+    if (pthread_create(&pool->thread[pool->workers], NULL, pool_worker,
+                       pool) != 0) {
+      thread_pool_destroy(pool);
+      return NULL;
+    }
+  }
+
+  return pool;
+}
+
+void thread_pool_destroy(thread_pool_t *pool)
+{
+  int i;
+
+  if (pool == NULL) {
+    return;
+  }
+
+  if (pool->workers > 0) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->not_empty);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->workers; i++) {
+      pthread_join(pool->thread[i], NULL);
+    }
+  }
+  pthread_mutex_destroy(&pool->lock);
+  pthread_cond_destroy(&pool->not_empty);
+
+  free(pool->thread);
+  free(pool->entry);
+  free(pool->flow_of);
+  free(pool->free_list);
+  free(pool->jobs);
+  free(pool);
+}
+
+/** @internal take a free job for flow, lock must be held
+ *
+ */
+static void *pool_take(thread_pool_t *pool, thread_pool_flow_t *flow)
+{
+  void *job;
+
+  if (pool->free_count == 0) {
+    return NULL;
+  }
+  job = pool->free_list[--pool->free_count];
+  pool->flow_of[pool_index(pool, job)] = flow;
+  flow->held++;
+
+  return job;
+}
+
+void *thread_pool_job_get(thread_pool_t *pool)
+{
+  void *job;
+
+  pthread_mutex_lock(&pool->lock);
+  job = pool_take(pool, &pool->fifo);
+  pthread_mutex_unlock(&pool->lock);
+
+  return job;
+}
+
+void *thread_pool_job_get_flow(thread_pool_t *pool,
+                               thread_pool_flow_t *flow)
+{
+  void *job = NULL;
+
+  pthread_mutex_lock(&pool->lock);
+  if (flow->held == 0 || flow->held < pool->free_count) {
+    job = pool_take(pool, flow);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return job;
+}
+
+void thread_pool_submit_cost(thread_pool_t *pool, void *job,
+                             unsigned cost)
+{
+  thread_pool_flow_t *f;
+  pool_entry_t *e;
+  size_t i;
+
+  pthread_mutex_lock(&pool->lock);
+  i = pool_index(pool, job);
+  f = pool->flow_of[i];
+  e = &pool->entry[i];
+  e->next = NULL;
+  e->cost = cost > 0 ? cost : 1;
+
+  if (f->tail != NULL) {
+    f->tail->next = e;
+  } else {
+    /* idle flow, it joins the round at the back */
+    f->head = e;
+    if (pool->active != NULL) {
+      pool->active_tail->next = f;
+    } else {
+      pool->active = f;
+    }
+    pool->active_tail = f;
+    pool->active_count++;
+  }
+  f->tail = e;
+  pool->count++;
+  pthread_cond_signal(&pool->not_empty);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_submit(thread_pool_t *pool, void *job)
+{
+  thread_pool_submit_cost(pool, job, 1);
+}
+
+thread_pool_flow_t *thread_pool_flow_create(int weight)
+{
+  thread_pool_flow_t *flow;
+
+  if ((flow = calloc(1, sizeof(*flow))) == NULL) {
+    return NULL;
+  }
+  flow->quantum = (unsigned long)(weight > 0 ? weight : 1) *
+                  THREAD_POOL_QUANTUM;
+
+  return flow;
+}
+
+void thread_pool_flow_destroy(thread_pool_flow_t *flow)
+{
+  free(flow);
+}
+
+int thread_pool_workers(const thread_pool_t *pool)
+{
+  return pool->workers;
+}
+
+size_t thread_pool_pending(thread_pool_t *pool)
+{
+  size_t count;
+
+  pthread_mutex_lock(&pool->lock);
+  count = pool->count;
+  pthread_mutex_unlock(&pool->lock);
+
+  return count;
+}
+
+/*EOF*/
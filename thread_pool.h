@@ -0,0 +1,99 @@
+/**
+ * @file thread_pool.h
+ * @date 17 Oct 2026
+ * @brief Fixed size worker pool fed by a bounded job queue
+ *
+ *        The pool owns a fixed number of job objects (queue length
+ *        plus one per worker).  A producer takes a free job, fills it
+ *        and submits it, the job goes back to the free list as soon as
+ *        a worker has processed it.
+ *
+ *        Jobs are queued per flow (one per client, say) and the
+ *        workers take them by deficit round robin: every round a flow
+ *        may start jobs worth weight * THREAD_POOL_QUANTUM cost units,
+ *        so a flow with a deep queue cannot delay the jobs of the
+ *        others by more than one round.  Jobs submitted without a flow
+ *        share one default flow and run in FIFO order.
+ *
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h>
+
+/** @brief cost units a flow of weight 1 may start per round */
+#define THREAD_POOL_QUANTUM 1
+
+typedef struct thread_pool_s thread_pool_t;
+typedef struct thread_pool_flow_s thread_pool_flow_t;
+
+/** @brief called by a worker thread for every submitted job */
+typedef void (*pool_work_fn_t)(void *job);
+
+/** @brief start the workers
+ *
+ *  @param workers   number of worker threads, <= 0 uses all CPUs
+ *  @param queue_len number of jobs that can wait for a worker
+ *  @param job_size  size of one job object
+ *
+ *  @retrun NULL on error
+ */
+thread_pool_t *thread_pool_create(int workers, size_t queue_len,
+                                  size_t job_size, pool_work_fn_t fn);
+
+/** @brief stop the workers and free the pool
+ *
+ *  Running and queued jobs are finished first, a caller that wants a
+ *  quick stop makes its jobs return early (e.g. a cancel flag).
+ */
+void thread_pool_destroy(thread_pool_t *pool);
+
+/** @brief take a free job object
+ *
+ *  @retrun NULL if all jobs are in use (queue full)
+ */
+void *thread_pool_job_get(thread_pool_t *pool);
+
+/** @brief hand a job from thread_pool_job_get() to the workers */
+void thread_pool_submit(thread_pool_t *pool, void *job);
+
+/** @brief create a flow with a queue of its own
+ *
+ *  @param weight share of the workers relative to other flows, >= 1
+ *
+ *  @retrun NULL on error
+ */
+thread_pool_flow_t *thread_pool_flow_create(int weight);
+
+/** @brief free a flow, none of its jobs may be queued
+ *
+ *  May be called after thread_pool_destroy().
+ */
+void thread_pool_flow_destroy(thread_pool_flow_t *flow);
+
+/** @brief take a free job object for flow
+ *
+ *  A flow is refused once it has as many jobs queued as there are
+ *  free ones left, so one flow cannot fill the whole queue.
+ *
+ *  @retrun NULL if all jobs are in use or flow holds its share
+ */
+void *thread_pool_job_get_flow(thread_pool_t *pool,
+                               thread_pool_flow_t *flow);
+
+/** @brief hand a job to the workers, it costs cost units of the round
+ *         of its flow (1 for thread_pool_submit())
+ */
+void thread_pool_submit_cost(thread_pool_t *pool, void *job,
+                             unsigned cost);
+
+/** @brief number of worker threads */
+int thread_pool_workers(const thread_pool_t *pool);
+
+/** @brief number of submitted jobs no worker has taken yet */
+size_t thread_pool_pending(thread_pool_t *pool);
+
+#endif
+
+/*EOF*/